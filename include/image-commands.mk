@@ -132,9 +132,30 @@ define Build/lzma
 	$(call Build/lzma-no-dict,-lc1 -lp2 -pb2 $(1))
 endef
 
+# Many devices share the same kernel binary and compression options, so
+# compressed results are kept in $(KDIR)/cache, keyed by a hash of the
+# options and the input data. Only the most recently used
+# LZMA_CACHE_ENTRIES results are kept. New entries are written under a
+# .tmp- name outside the lzma-* glob, and eviction runs under a lock; a
+# lookup that loses the race against it just compresses again.
+LZMA_CACHE_ENTRIES ?= 32
+
 define Build/lzma-no-dict
-	$(STAGING_DIR_HOST)/bin/lzma e $@ $(1) $@.new
-	@mv $@.new $@
+	hash="$$( (echo '$(1)'; cat $@) | $(STAGING_DIR_HOST)/bin/mkhash md5)"; \
+	cache="$(KDIR)/cache/lzma-$$hash"; \
+	tmp="$(KDIR)/cache/.tmp-lzma-$$hash.$$$$"; \
+	mkdir -p $(KDIR)/cache && \
+	{ cp "$$cache" $@.new 2>/dev/null || { \
+		$(STAGING_DIR_HOST)/bin/lzma e $@ $(1) $@.new && \
+		cp $@.new "$$tmp" && \
+		mv "$$tmp" "$$cache"; \
+	}; } && \
+	mv $@.new $@ && \
+	$(STAGING_DIR_HOST)/bin/flock $(KDIR)/cache/.lock sh -c ' \
+		touch -c "$$0"; \
+		ls -t $(KDIR)/cache/lzma-* | \
+			tail -n +$$(($(LZMA_CACHE_ENTRIES) + 1)) | xargs -r rm -f' \
+		"$$cache"
 endef
 
 define Build/gzip
@@ -143,17 +164,17 @@ define Build/gzip
 endef
 
 define Build/jffs2
-	rm -rf $(KDIR_TMP)/$(DEVICE_NAME)/jffs2 && \
-		mkdir -p $(KDIR_TMP)/$(DEVICE_NAME)/jffs2/$$(dirname $(1)) && \
-		cp $@ $(KDIR_TMP)/$(DEVICE_NAME)/jffs2/$(1) && \
+	rm -rf $@.jffs2 && \
+		mkdir -p $@.jffs2/$$(dirname $(1)) && \
+		cp $@ $@.jffs2/$(1) && \
 		$(STAGING_DIR_HOST)/bin/mkfs.jffs2 --pad \
 			$(if $(CONFIG_BIG_ENDIAN),--big-endian,--little-endian) \
 			--squash-uids -v -e $(patsubst %k,%KiB,$(BLOCKSIZE)) \
 			-o $@.new \
-			-d $(KDIR_TMP)/$(DEVICE_NAME)/jffs2 \
+			-d $@.jffs2 \
 			2>&1 1>/dev/null | awk '/^.+$$$$/' && \
 		$(STAGING_DIR_HOST)/bin/padjffs2 $@.new -J $(patsubst %k,,$(BLOCKSIZE))
-	-rm -rf $(KDIR_TMP)/$(DEVICE_NAME)/jffs2/
+	-rm -rf $@.jffs2/
 	@mv $@.new $@
 endef
 
@@ -175,6 +196,7 @@ define Build/append-rootfs
 endef
 
 define Build/append-ubi
+	UBINIZE_CACHE_DIR=$(KDIR)/ubi-cache \
 	sh $(TOPDIR)/scripts/ubinize-image.sh \
 		$(if $(UBOOTENV_IN_UBI),--uboot-env) \
 		$(if $(KERNEL_IN_UBI),--kernel $(IMAGE_KERNEL)) \
@@ -189,9 +211,13 @@ define Build/append-ubi
 	rm $@.tmp
 endef
 
+# zero padding is done by extending the file in place instead of copying it,
+# the block size is still parsed by dd so that all of its suffixes work
 define Build/pad-to
-	dd if=$@ of=$@.new bs=$(1) conv=sync
-	mv $@.new $@
+	pad="$$(dd if=/dev/zero bs=$(1) count=1 2>/dev/null | wc -c)"; \
+	[ "$$pad" -gt 0 ] || { echo "pad-to: invalid size '$(1)'" >&2; exit 1; }; \
+	let newsize="($$(stat -c%s $@) + pad - 1) / pad * pad"; \
+	dd if=/dev/null of=$@ bs=1 count=0 seek=$$newsize
 endef
 
 define Build/pad-extra
@@ -210,8 +236,7 @@ define Build/pad-offset
 		offset="$(subst k,* 1024,$(word 2, $(1)))" \
 		pad="(pad - ((size + offset) % pad)) % pad" \
 		newsize='size + pad'; \
-		dd if=$@ of=$@.new bs=$$newsize count=1 conv=sync
-	mv $@.new $@
+		dd if=/dev/null of=$@ bs=1 count=0 seek=$$newsize
 endef
 
 define Build/check-size
@@ -78,6 +78,9 @@ SQUASHFS_BLOCKSIZE := $(CONFIG_TARGET_SQUASHFS_BLOCK_SIZE)k
 SQUASHFSOPT := -b $(SQUASHFS_BLOCKSIZE)
 SQUASHFSOPT += -p '/dev d 755 0 0' -p '/dev/console c 600 0 0 5 1'
 SQUASHFSCOMP := gzip
+# mksquashfs 4.2 lays out fragments in the order its compressor threads
+# finish, so only a single thread gives reproducible images
+SQUASHFS_PROCESSORS ?= 1
 LZMA_XZ_OPTIONS := -Xpreset 9 -Xe -Xlc 0 -Xlp 2 -Xpb 2
 ifeq ($(CONFIG_SQUASHFS_XZ),y)
   ifneq ($(filter arm x86 powerpc sparc,$(LINUX_KARCH)),)
@@ -204,7 +207,7 @@ define Image/mkfs/squashfs
 	$(STAGING_DIR_HOST)/bin/mksquashfs4 $(call mkfs_target_dir,$(1)) $@ \
 		-nopad -noappend -root-owned \
 		-comp $(SQUASHFSCOMP) $(SQUASHFSOPT) \
-		-processors 1 \
+		-processors $(SQUASHFS_PROCESSORS) \
 		$(if $(SOURCE_DATE_EPOCH),-fixed-time $(SOURCE_DATE_EPOCH))
 endef
 
@@ -291,8 +294,60 @@ opkg_target = \
 	$(call opkg,$(mkfs_cur_target_dir)) \
 		-f $(mkfs_cur_target_dir).conf
 
-target-dir-%: FORCE
-	rm -rf $(mkfs_cur_target_dir) $(mkfs_cur_target_dir).opkg
+# Per-device target dirs and the filesystems generated from them can be kept
+# in a cache shared between builds (set ROOTFS_CACHE_DIR to enable it). The
+# key covers everything that goes into a target dir: the package list, the
+# package index (which carries the checksum of every ipk), the base rootfs,
+# the files/ overlay, the options and scripts used by prepare_rootfs and the
+# makefiles defining it. With mklibs the result depends on the whole staging
+# dir, so the cache is not used.
+ROOTFS_CACHE_DIR ?=
+ROOTFS_CACHE_LOG = $(KDIR)/rootfs-cache.log
+
+ROOTFS_CACHE_INPUTS = \
+	$(INCLUDE_DIR)/image.mk \
+	$(INCLUDE_DIR)/rootfs.mk \
+	$(SCRIPT_DIR)/ramfs-manifest.sh \
+	$(STAGING_DIR_HOST)/bin/opkg
+
+# Prints nothing if any input can't be read, see target-dir-%
+mkfs_cache_key = $(if $(and $(ROOTFS_CACHE_DIR),$(if $(CONFIG_USE_MKLIBS),,1)),$(shell \
+	set -o pipefail; \
+	key="$$( ( \
+		echo '$(sort $(mkfs_packages))'; \
+		echo 'CLEAN_IPKG=$(CONFIG_CLEAN_IPKG) SOURCE_DATE_EPOCH=$(SOURCE_DATE_EPOCH)'; \
+		echo 'TARGET_INIT_PATH=$(TARGET_INIT_PATH)'; \
+		cat $(ROOTFS_CACHE_INPUTS) $(PACKAGE_DIR_ALL)/Packages && \
+		for dir in $(TARGET_DIR_ORIG) $(wildcard $(TOPDIR)/files); do \
+			$(TAR) -C $$dir -cf - --sort=name --mtime=@0 \
+				--numeric-owner --owner=0 --group=0 . || exit 1; \
+		done ) | $(STAGING_DIR_HOST)/bin/mkhash md5)" && echo "$$key"))
+mkfs_cache_dir = $(if $(ROOTFS_KEY/$(1)),$(ROOTFS_CACHE_DIR)/target-dir-$(ROOTFS_KEY/$(1)))
+
+# The image key covers the full mkfs command line and the host tools it runs,
+# so any change in the filesystem options or tools results in a new image
+mkfs_cache_image_cmd = $(strip $(call Image/mkfs/$(word 1,$(target_params)),$(target_params)))
+mkfs_cache_image_key = $(if $(ROOTFS_KEY/$(1)),$(shell \
+	set -o pipefail; \
+	key="$$( ( \
+		echo '$(ROOTFS_KEY/$(1)) $(subst ','\'',$(mkfs_cache_image_cmd))'; \
+		cat $(sort $(filter $(STAGING_DIR_HOST)/bin/%,$(mkfs_cache_image_cmd))) \
+		) | $(STAGING_DIR_HOST)/bin/mkhash md5)" && echo "$$key"))
+
+define rootfs_cache_store
+	rm -rf $(2).tmp
+	mkdir -p $(ROOTFS_CACHE_DIR)
+	$(3) $(1) $(2).tmp
+	mv -T $(2).tmp $(2) || rm -rf $(2).tmp
+	echo "miss $(notdir $(2))" >> $(ROOTFS_CACHE_LOG)
+endef
+
+define rootfs_cache_restore
+	$(3) $(1) $(2)
+	echo "hit $(notdir $(1))" >> $(ROOTFS_CACHE_LOG)
+endef
+
+define target_dir_build
 	$(CP) $(TARGET_DIR_ORIG) $(mkfs_cur_target_dir)
 	-mv $(mkfs_cur_target_dir)/etc/opkg $(mkfs_cur_target_dir).opkg
 	echo 'src default file://$(PACKAGE_DIR_ALL)' > $(mkfs_cur_target_dir).conf
@@ -306,9 +361,35 @@ target-dir-%: FORCE
 	$(call prepare_rootfs,$(mkfs_cur_target_dir))
 	-mv $(mkfs_cur_target_dir).opkg $(mkfs_cur_target_dir)/etc/opkg
 	rm -f $(mkfs_cur_target_dir).conf
+endef
+
+target-dir-%: FORCE
+	$(eval ROOTFS_KEY/$* := $(mkfs_cache_key))
+	$(if $(and $(ROOTFS_CACHE_DIR),$(if $(CONFIG_USE_MKLIBS),,1),$(if $(ROOTFS_KEY/$*),,1)), \
+		$(error Failed to compute the rootfs cache key for $*))
+	rm -rf $(mkfs_cur_target_dir) $(mkfs_cur_target_dir).opkg
+	$(if $(wildcard $(call mkfs_cache_dir,$*)), \
+		$(call rootfs_cache_restore,$(call mkfs_cache_dir,$*),$(mkfs_cur_target_dir),cp -a --reflink=auto), \
+		$(target_dir_build))
+	$(if $(call mkfs_cache_dir,$*),$(if $(wildcard $(call mkfs_cache_dir,$*)),, \
+		$(call rootfs_cache_store,$(mkfs_cur_target_dir),$(call mkfs_cache_dir,$*),cp -a --reflink=auto)))
 
 $(KDIR)/root.%: kernel_prepare
-	$(call Image/mkfs/$(word 1,$(target_params)),$(target_params))
+	$(eval mkfs_cache_image := $(call mkfs_cache_image_key,$(call param_get,pkg,$(target_params))))
+	$(if $(and $(ROOTFS_KEY/$(call param_get,pkg,$(target_params))),$(if $(mkfs_cache_image),,1)), \
+		$(error Failed to compute the image cache key for $@))
+	$(if $(and $(mkfs_cache_image),$(wildcard $(ROOTFS_CACHE_DIR)/root-$(mkfs_cache_image))), \
+		$(call rootfs_cache_restore,$(ROOTFS_CACHE_DIR)/root-$(mkfs_cache_image),$@,cp --reflink=auto), \
+		$(call Image/mkfs/$(word 1,$(target_params)),$(target_params)))
+	$(if $(mkfs_cache_image),$(if $(wildcard $(ROOTFS_CACHE_DIR)/root-$(mkfs_cache_image)),, \
+		$(call rootfs_cache_store,$@,$(ROOTFS_CACHE_DIR)/root-$(mkfs_cache_image),cp --reflink=auto)))
+
+define Image/CacheStats
+	@if [ -f $(ROOTFS_CACHE_LOG) ]; then \
+		echo "Rootfs cache: $$(grep -c '^hit ' $(ROOTFS_CACHE_LOG)) hits, $$(grep -c '^miss ' $(ROOTFS_CACHE_LOG)) misses"; \
+		rm -f $(ROOTFS_CACHE_LOG); \
+	fi
+endef
 
 define Device/InitProfile
   PROFILES := $(PROFILE)
@@ -593,5 +674,6 @@ define BuildImage
 
   install: install-images
 	$(call Image/Manifest)
+	$(if $(TARGET_PER_DEVICE_ROOTFS),$$(call Image/CacheStats))
 
 endef
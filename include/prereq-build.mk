@@ -159,6 +159,12 @@ $(STAGING_DIR_HOST)/bin/mkhash: $(SCRIPT_DIR)/mkhash.c
 
 prereq: $(STAGING_DIR_HOST)/bin/mkhash
 
+$(STAGING_DIR_HOST)/bin/rstrip: $(SCRIPT_DIR)/rstrip.c
+	mkdir -p $(dir $@)
+	$(CC) -O2 -I$(TOPDIR)/tools/include -o $@ $<
+
+prereq: $(STAGING_DIR_HOST)/bin/rstrip
+
 # Install ldconfig stub
 $(eval $(call TestHostCommand,ldconfig-stub,Failed to install stub, \
 	touch $(STAGING_DIR_HOST)/bin/ldconfig && \
@@ -85,5 +85,15 @@ define prepare_rootfs
 	rm -f $(1)/usr/lib/opkg/info/*.postinst*
 	rm -f $(1)/usr/lib/opkg/info/*.prerm*
 	$(call clean_ipkg,$(1))
+	@[ ! -f $(1)/usr/lib/opkg/status ] || ( \
+		cd $(1); \
+		sed -ne 's,^ /\([^ ]*\) [0-9a-fA-F]*$$,\1,p' usr/lib/opkg/status | \
+			xargs -r md5sum 2>/dev/null | sed -e 's,  ,  /,' \
+			> usr/lib/opkg/conffiles.md5; \
+		true \
+	)
 	$(call mklibs,$(1))
+	@[ ! -f $(1)/lib/upgrade/ramfs.binaries ] || \
+		$(SCRIPT_DIR)/ramfs-manifest.sh $(1) $(TARGET_INIT_PATH) > $(1)/lib/upgrade/ramfs.manifest || \
+		rm -f $(1)/lib/upgrade/ramfs.manifest
 endef
@@ -34,6 +34,15 @@ list_contains() {
 	[ "${val%% $str *}" != "$val" ]
 }
 
+# boot_trace <stage> <name> <event> [<status>]
+# Appends an uptime stamped record to /tmp/boot.trace
+boot_trace() {
+	local uptime rest
+
+	read uptime rest < /proc/uptime 2>/dev/null || return 0
+	echo "$uptime $*" >> /tmp/boot.trace 2>/dev/null
+}
+
 config_load() {
 	[ -n "$IPKG_INSTROOT" ] && return 0
 	uci_load "$@"
@@ -75,12 +84,16 @@ list() {
 	local value="$*"
 	local len
 
-	config_get len "$CONFIG_SECTION" "${varname}_LENGTH" 0
+	eval "len=\${CONFIG_${CONFIG_SECTION}_${varname}_LENGTH:-0}"
 	[ $len = 0 ] && append CONFIG_LIST_STATE "${CONFIG_SECTION}_${varname}"
 	len=$(($len + 1))
-	config_set "$CONFIG_SECTION" "${varname}_ITEM$len" "$value"
-	config_set "$CONFIG_SECTION" "${varname}_LENGTH" "$len"
+	export ${NO_EXPORT:+-n} "CONFIG_${CONFIG_SECTION}_${varname}_ITEM$len=$value"
+	export ${NO_EXPORT:+-n} "CONFIG_${CONFIG_SECTION}_${varname}_LENGTH=$len"
 	append "CONFIG_${CONFIG_SECTION}_${varname}" "$value" "$LIST_SEP"
+	[ -n "$NO_CALLBACK" ] || {
+		option_cb "${varname}_ITEM$len" "$value"
+		option_cb "${varname}_LENGTH" "$len"
+	}
 	list_cb "$varname" "$*"
 }
 
@@ -129,7 +142,7 @@ config_foreach() {
 
 	[ -z "$CONFIG_SECTIONS" ] && return 0
 	for section in ${CONFIG_SECTIONS}; do
-		config_get cfgtype "$section" TYPE
+		eval "cfgtype=\${CONFIG_${section}_TYPE}"
 		[ -n "$___type" -a "x$cfgtype" != "x$___type" ] && continue
 		eval "$___function \"\$section\" \"\$@\""
 	done
@@ -144,10 +157,10 @@ config_list_foreach() {
 	local len
 	local c=1
 
-	config_get len "${section}" "${option}_LENGTH"
+	eval "len=\${CONFIG_${section}_${option}_LENGTH}"
 	[ -z "$len" ] && return 0
 	while [ $c -le "$len" ]; do
-		config_get val "${section}" "${option}_ITEM$c"
+		eval "val=\${CONFIG_${section}_${option}_ITEM$c}"
 		eval "$function \"\$val\" \"\$@\""
 		c="$(($c + 1))"
 	done
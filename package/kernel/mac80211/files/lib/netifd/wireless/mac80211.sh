@@ -143,7 +143,7 @@ mac80211_hostapd_setup_base() {
 			dsss_cck_40:1
 
 		ht_cap_mask=0
-		for cap in $(iw phy "$phy" info | grep 'Capabilities:' | cut -d: -f2); do
+		for cap in $(echo "$phy_info" | grep 'Capabilities:' | cut -d: -f2); do
 			ht_cap_mask="$(($ht_cap_mask | $cap))"
 		done
 
@@ -225,7 +225,7 @@ mac80211_hostapd_setup_base() {
 
 		append base_cfg "ieee80211ac=1" "$N"
 		vht_cap=0
-		for cap in $(iw phy "$phy" info | awk -F "[()]" '/VHT Capabilities/ { print $2 }'); do
+		for cap in $(echo "$phy_info" | awk -F "[()]" '/VHT Capabilities/ { print $2 }'); do
 			vht_cap="$(($vht_cap | $cap))"
 		done
 
@@ -347,8 +347,10 @@ mac80211_generate_mac() {
 	local phy="$1"
 	local id="${macidx:-0}"
 
-	local ref="$(cat /sys/class/ieee80211/${phy}/macaddress)"
-	local mask="$(cat /sys/class/ieee80211/${phy}/address_mask)"
+	local ref mask
+
+	read ref < /sys/class/ieee80211/${phy}/macaddress
+	read mask < /sys/class/ieee80211/${phy}/address_mask
 
 	[ "$mask" = "00:00:00:00:00:00" ] && {
 		mask="ff:ff:ff:ff:ff:ff";
@@ -713,7 +715,7 @@ mac80211_setup_vif() {
 get_freq() {
 	local phy="$1"
 	local chan="$2"
-	iw "$phy" info | grep -E -m1 "(\* ${chan:-....} MHz${chan:+|\\[$chan\\]})" | grep MHz | awk '{print $2}'
+	echo "$phy_info" | grep -E -m1 "(\* ${chan:-....} MHz${chan:+|\\[$chan\\]})" | grep MHz | awk '{print $2}'
 }
 
 mac80211_interface_cleanup() {
@@ -749,6 +751,10 @@ drv_mac80211_setup() {
 	wireless_set_data phy="$phy"
 	mac80211_interface_cleanup "$phy"
 
+	# queried once for the channel lookups, and again below once the
+	# antenna setup is done
+	phy_info="$(iw phy "$phy" info)"
+
 	# convert channel to frequency
 	[ "$auto_channel" -gt 0 ] || freq="$(get_freq "$phy" "$channel")"
 
@@ -783,6 +789,10 @@ drv_mac80211_setup() {
 	[ -n "$frag" ] && iw phy "$phy" set frag "${frag%%.*}"
 	[ -n "$rts" ] && iw phy "$phy" set rts "${rts%%.*}"
 
+	# drivers like ath9k and ath10k recompute the HT/VHT capabilities
+	# when the chainmask changes, so read them back for hostapd
+	phy_info="$(iw phy "$phy" info)"
+
 	has_ap=
 	hostapd_ctrl=
 	for_each_interface "ap" mac80211_check_ap
@@ -19,33 +19,108 @@
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
 #include <linux/debugfs.h>
+#include <linux/percpu.h>
+#include <linux/u64_stats_sync.h>
+
+#define TRELAY_MAX_DEVS		8
 
 static LIST_HEAD(trelay_devs);
 static struct dentry *debugfs_dir;
 
+struct trelay_stats {
+	u64 rx_packets;
+	u64 rx_bytes;
+	u64 tx_packets;
+	u64 tx_dropped;
+	u64 pae_packets;
+	struct u64_stats_sync syncp;
+};
+
 struct trelay {
 	struct list_head list;
-	struct net_device *dev1, *dev2;
+	struct trelay_stats __percpu *stats;
 	struct dentry *debugfs;
+	int n_devs;
+	struct net_device *devs[TRELAY_MAX_DEVS];
 	char name[];
 };
 
+static void trelay_xmit(struct trelay_stats *stats, struct sk_buff *skb,
+			struct net_device *dev)
+{
+	int ret;
+
+	skb->dev = dev;
+	ret = dev_queue_xmit(skb);
+
+	u64_stats_update_begin(&stats->syncp);
+	if (net_xmit_eval(ret))
+		stats->tx_dropped++;
+	else
+		stats->tx_packets++;
+	u64_stats_update_end(&stats->syncp);
+}
+
 rx_handler_result_t trelay_handle_frame(struct sk_buff **pskb)
 {
-	struct net_device *dev;
-	struct sk_buff *skb = *pskb;
+	struct sk_buff *nskb, *skb = *pskb;
+	struct net_device *out = NULL;
+	struct trelay_stats *stats;
+	struct trelay *tr;
+	int i, n_devs;
 
-	dev = rcu_dereference(skb->dev->rx_handler_data);
-	if (!dev)
+	tr = rcu_dereference(skb->dev->rx_handler_data);
+	if (!tr)
 		return RX_HANDLER_PASS;
 
-	if (skb->protocol == htons(ETH_P_PAE))
+	stats = this_cpu_ptr(tr->stats);
+
+	if (skb->protocol == htons(ETH_P_PAE)) {
+		u64_stats_update_begin(&stats->syncp);
+		stats->pae_packets++;
+		u64_stats_update_end(&stats->syncp);
 		return RX_HANDLER_PASS;
+	}
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->rx_packets++;
+	stats->rx_bytes += skb->len;
+	u64_stats_update_end(&stats->syncp);
 
 	skb_push(skb, ETH_HLEN);
-	skb->dev = dev;
 	skb_forward_csum(skb);
-	dev_queue_xmit(skb);
+
+	/* like a hub: every other member of the group gets a copy; the
+	 * handler runs as soon as it is registered, so only look at the
+	 * members trelay_do_add() has published */
+	n_devs = smp_load_acquire(&tr->n_devs);
+	for (i = 0; i < n_devs; i++) {
+		if (tr->devs[i] == skb->dev)
+			continue;
+
+		if (out) {
+			nskb = skb_clone(skb, GFP_ATOMIC);
+			if (nskb) {
+				trelay_xmit(stats, nskb, out);
+			} else {
+				u64_stats_update_begin(&stats->syncp);
+				stats->tx_dropped++;
+				u64_stats_update_end(&stats->syncp);
+			}
+		}
+
+		out = tr->devs[i];
+	}
+
+	if (!out) {
+		u64_stats_update_begin(&stats->syncp);
+		stats->tx_dropped++;
+		u64_stats_update_end(&stats->syncp);
+		kfree_skb(skb);
+		return RX_HANDLER_CONSUMED;
+	}
+
+	trelay_xmit(stats, skb, out);
 
 	return RX_HANDLER_CONSUMED;
 }
@@ -58,15 +133,17 @@ static int trelay_open(struct inode *inode, struct file *file)
 
 static int trelay_do_remove(struct trelay *tr)
 {
-	list_del(&tr->list);
+	int i;
 
-	dev_put(tr->dev1);
-	dev_put(tr->dev2);
+	list_del(&tr->list);
 
-	netdev_rx_handler_unregister(tr->dev1);
-	netdev_rx_handler_unregister(tr->dev2);
+	for (i = 0; i < tr->n_devs; i++) {
+		netdev_rx_handler_unregister(tr->devs[i]);
+		dev_put(tr->devs[i]);
+	}
 
 	debugfs_remove_recursive(tr->debugfs);
+	free_percpu(tr->stats);
 	kfree(tr);
 
 	return 0;
@@ -75,10 +152,12 @@ static int trelay_do_remove(struct trelay *tr)
 static struct trelay *trelay_find(struct net_device *dev)
 {
 	struct trelay *tr;
+	int i;
 
 	list_for_each_entry(tr, &trelay_devs, list) {
-		if (tr->dev1 == dev || tr->dev2 == dev)
-			return tr;
+		for (i = 0; i < tr->n_devs; i++)
+			if (tr->devs[i] == dev)
+				return tr;
 	}
 	return NULL;
 }
@@ -125,17 +204,69 @@ static const struct file_operations fops_remove = {
 	.llseek = default_llseek,
 };
 
+static ssize_t trelay_stats_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct trelay *tr = file->private_data;
+	struct trelay_stats sum = {};
+	char buf[256];
+	int cpu, len;
+
+	for_each_possible_cpu(cpu) {
+		const struct trelay_stats *stats = per_cpu_ptr(tr->stats, cpu);
+		u64 rx_packets, rx_bytes, tx_packets, tx_dropped, pae_packets;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&stats->syncp);
+			rx_packets = stats->rx_packets;
+			rx_bytes = stats->rx_bytes;
+			tx_packets = stats->tx_packets;
+			tx_dropped = stats->tx_dropped;
+			pae_packets = stats->pae_packets;
+		} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+		sum.rx_packets += rx_packets;
+		sum.rx_bytes += rx_bytes;
+		sum.tx_packets += tx_packets;
+		sum.tx_dropped += tx_dropped;
+		sum.pae_packets += pae_packets;
+	}
+
+	len = scnprintf(buf, sizeof(buf),
+			"rx_packets: %llu\n"
+			"rx_bytes: %llu\n"
+			"tx_packets: %llu\n"
+			"tx_dropped: %llu\n"
+			"pae_packets: %llu\n",
+			sum.rx_packets, sum.rx_bytes, sum.tx_packets,
+			sum.tx_dropped, sum.pae_packets);
 
-static int trelay_do_add(char *name, char *devn1, char *devn2)
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static const struct file_operations fops_stats = {
+	.owner = THIS_MODULE,
+	.open = trelay_open,
+	.read = trelay_stats_read,
+	.llseek = default_llseek,
+};
+
+static int trelay_do_add(char *name, char **devn, int n_devs)
 {
-	struct net_device *dev1, *dev2;
 	struct trelay *tr, *tr1;
-	int ret;
+	int i, ret;
 
 	tr = kzalloc(sizeof(*tr) + strlen(name) + 1, GFP_KERNEL);
 	if (!tr)
 		return -ENOMEM;
 
+	tr->stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	if (!tr->stats) {
+		kfree(tr);
+		return -ENOMEM;
+	}
+
 	rtnl_lock();
 	rcu_read_lock();
 
@@ -146,38 +277,44 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	}
 
 	ret = -ENOENT;
-	dev1 = dev_get_by_name_rcu(&init_net, devn1);
-	dev2 = dev_get_by_name_rcu(&init_net, devn2);
-	if (!dev1 || !dev2)
-		goto out;
-
-	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, dev2);
-	if (ret < 0)
-		goto out;
+	for (i = 0; i < n_devs; i++) {
+		tr->devs[i] = dev_get_by_name_rcu(&init_net, devn[i]);
+		if (!tr->devs[i])
+			goto out;
+	}
 
-	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, dev1);
-	if (ret < 0) {
-		netdev_rx_handler_unregister(dev1);
-		goto out;
+	for (i = 0; i < n_devs; i++) {
+		ret = netdev_rx_handler_register(tr->devs[i],
+						 trelay_handle_frame, tr);
+		if (ret < 0)
+			goto out_unregister;
 	}
 
-	dev_hold(dev1);
-	dev_hold(dev2);
+	for (i = 0; i < n_devs; i++)
+		dev_hold(tr->devs[i]);
+
+	/* devs[] is complete, let the rx handlers see the whole group */
+	smp_store_release(&tr->n_devs, n_devs);
 
 	strcpy(tr->name, name);
-	tr->dev1 = dev1;
-	tr->dev2 = dev2;
 	list_add_tail(&tr->list, &trelay_devs);
 
 	tr->debugfs = debugfs_create_dir(name, debugfs_dir);
 	debugfs_create_file("remove", S_IWUSR, tr->debugfs, tr, &fops_remove);
+	debugfs_create_file("stats", S_IRUSR, tr->debugfs, tr, &fops_stats);
 	ret = 0;
+	goto out;
 
+out_unregister:
+	while (i--)
+		netdev_rx_handler_unregister(tr->devs[i]);
 out:
 	rcu_read_unlock();
 	rtnl_unlock();
-	if (ret < 0)
+	if (ret < 0) {
+		free_percpu(tr->stats);
 		kfree(tr);
+	}
 
 	return ret;
 }
@@ -185,11 +322,17 @@ out:
 static ssize_t trelay_add_write(struct file *file, const char __user *ubuf,
 				size_t count, loff_t *ppos)
 {
+	char *devn[TRELAY_MAX_DEVS];
 	char buf[256];
-	char *dev1, *dev2, *tmp;
+	char *name, *cur, *tmp;
 	ssize_t len, ret;
+	int n_devs = 0;
+
+	/* a truncated list would silently create a different group */
+	if (count >= sizeof(buf))
+		return -EINVAL;
 
-	len = min(count, sizeof(buf) - 1);
+	len = count;
 	if (copy_from_user(buf, ubuf, len))
 		return -EFAULT;
 
@@ -198,24 +341,26 @@ static ssize_t trelay_add_write(struct file *file, const char __user *ubuf,
 	if ((tmp = strchr(buf, '\n')))
 		*tmp = 0;
 
-	dev1 = strchr(buf, ',');
-	if (!dev1)
+	cur = buf;
+	name = strsep(&cur, ",");
+	if (!cur || !strlen(name))
 		return -EINVAL;
 
-	*(dev1++) = 0;
+	while (cur) {
+		if (n_devs == TRELAY_MAX_DEVS)
+			return -E2BIG;
 
-	dev2 = strchr(dev1, ',');
-	if (!dev2)
-		return -EINVAL;
+		devn[n_devs] = strsep(&cur, ",");
+		if (!strlen(devn[n_devs]))
+			return -EINVAL;
 
-	*(dev2++) = 0;
-	if (strchr(dev2, ','))
-		return -EINVAL;
+		n_devs++;
+	}
 
-	if (!strlen(buf) || !strlen(dev1) || !strlen(dev2))
+	if (n_devs < 2)
 		return -EINVAL;
 
-	ret = trelay_do_add(buf, dev1, dev2);
+	ret = trelay_do_add(name, devn, n_devs);
 	if (ret < 0)
 		return ret;
 
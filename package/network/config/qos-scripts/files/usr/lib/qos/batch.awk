@@ -0,0 +1,79 @@
+# Turns the command stream produced by generate.sh into a script that
+# applies all mangle table changes in a single iptables-restore transaction
+# per address family and all qdisc/class/filter changes through tc -batch.
+# Anything else (module loading, interface setup) is passed through and
+# runs before the batches.
+
+function trim(s) {
+	sub(/^[ \t]+/, "", s)
+	sub(/[ \t]+$/, "", s)
+	return s
+}
+
+function heredoc(cmd, lines, n,    i) {
+	if (!n) return
+	print cmd " <<'QOS_BATCH_EOF'"
+	for (i = 1; i <= n; i++)
+		print lines[i]
+	print "QOS_BATCH_EOF"
+}
+
+BEGIN {
+	n_ipt4 = n_ipt6 = 1
+	ipt4[1] = ipt6[1] = "*mangle"
+	n_tcdel = 0
+	n_tc = 0
+}
+
+{
+	line = trim($0)
+	if (line == "") next
+}
+
+($1 == "iptables" || $1 == "ip6tables") && (line ~ / -t mangle /) {
+	cmd = $1
+	sub(/^ip6?tables +/, "", line)
+	sub(/^-w +/, "", line)
+	sub(/-t mangle +/, "", line)
+	# iptables-restore only understands double quotes
+	gsub(/'/, "\"", line)
+
+	# per-rule invocations fail individually on addresses of the
+	# other family, a restore transaction would fail as a whole
+	if (cmd == "ip6tables") {
+		if (line ~ /-[sd] !? *[0-9]+\.[0-9]+\.[0-9]+\.[0-9]+/) next
+		ipt6[++n_ipt6] = line
+	} else {
+		if (line ~ /-[sd] !? *[^ ]*:/) next
+		ipt4[++n_ipt4] = line
+	}
+	next
+}
+
+$1 == "tc" {
+	sub(/^tc +/, "", line)
+	gsub(/ *[12]?>&- */, " ", line)
+	line = trim(line)
+	if (line ~ /^qdisc del /)
+		tcdel[++n_tcdel] = line
+	else
+		tc[++n_tc] = line
+	next
+}
+
+{
+	print $0
+}
+
+END {
+	if (n_ipt4 > 1) {
+		ipt4[++n_ipt4] = "COMMIT"
+		heredoc("iptables-restore --noflush", ipt4, n_ipt4)
+	}
+	if (n_ipt6 > 1) {
+		ipt6[++n_ipt6] = "COMMIT"
+		heredoc("ip6tables-restore --noflush", ipt6, n_ipt6)
+	}
+	heredoc("tc -force -batch - >&- 2>&-", tcdel, n_tcdel)
+	heredoc("tc -force -batch -", tc, n_tc)
+}
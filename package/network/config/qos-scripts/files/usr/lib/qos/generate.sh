@@ -360,6 +360,13 @@ EOF
 	unset INSMOD clsq clsf clsl d_clsq d_clsl d_clsf dev_up dev_down
 }
 
+stop_interfaces() {
+	for iface in $(tc qdisc show | grep -E '(hfsc|ingress)' | awk '{print $5}'); do
+		echo "tc qdisc del dev $iface ingress >&- 2>&-"
+		echo "tc qdisc del dev $iface root >&- 2>&-"
+	done
+}
+
 start_interfaces() {
 	local C="$1"
 	for iface in $INTERFACES; do
@@ -495,6 +502,12 @@ stop_firewall() {
 	done
 }
 
+batch() {
+	_dir=/usr/lib/qos
+	[ -e $_dir/batch.awk ] || _dir=.
+	awk -f $_dir/batch.awk
+}
+
 C="0"
 INTERFACES=""
 [ -e ./qos.conf ] && {
@@ -518,6 +531,21 @@ case "$1" in
 		start_interfaces "$C"
 		start_firewall
 	;;
+	start)
+		# same as "all", but applied as one iptables-restore
+		# transaction and one tc batch
+		{
+			stop_interfaces
+			start_interfaces "$C"
+			start_firewall
+		} | batch
+	;;
+	stop)
+		{
+			stop_interfaces
+			stop_firewall
+		} | batch
+	;;
 	interface)
 		start_interface "$2" "$C"
 	;;
@@ -2,45 +2,135 @@
 
 [ -f "$USER_DHCPSCRIPT" ] && . "$USER_DHCPSCRIPT" "$@"
 
+HOTPLUG_QUEUE=/var/run/dnsmasq-hotplug.queue
+HOTPLUG_QUEUE_LOCK=/var/lock/dnsmasq-hotplug.queue
+HOTPLUG_WORKER_LOCK=/var/lock/dnsmasq-hotplug.worker
+
+has_handlers() {
+	local file
+
+	for file in /etc/hotplug.d/$1/*; do
+		[ -f "$file" ] && return 0
+	done
+	return 1
+}
+
+hotplug_dispatch() {
+	local script
+
+	export HOTPLUG_TYPE="$1"
+	for script in /etc/hotplug.d/$1/*; do
+		[ -f "$script" ] && ( . "$script" )
+	done
+}
+
+# run the handlers of every queued event in this one shell, the way
+# hotplug-call would, until the queue stays empty
+hotplug_worker() {
+	. /lib/functions.sh
+
+	# each event brings its own variables, drop the ones of the
+	# dnsmasq call that happened to start the worker
+	unset ACTION MACADDR IPADDR HOSTNAME \
+		$(env | sed -n 's/^\(DNSMASQ_[A-Za-z0-9_]*\)=.*/\1/p')
+
+	PATH=/usr/sbin:/usr/bin:/sbin:/bin
+	LOGNAME=root
+	USER=root
+	export PATH LOGNAME USER
+	export DEVICENAME=
+
+	while :; do
+		while :; do
+			lock "$HOTPLUG_QUEUE_LOCK"
+			mv -f "$HOTPLUG_QUEUE" "$HOTPLUG_QUEUE.work" 2>/dev/null
+			lock -u "$HOTPLUG_QUEUE_LOCK"
+			[ -f "$HOTPLUG_QUEUE.work" ] || break
+
+			. "$HOTPLUG_QUEUE.work"
+			rm -f "$HOTPLUG_QUEUE.work"
+		done
+		lock -u "$HOTPLUG_WORKER_LOCK"
+
+		# an event queued after the last check found the worker lock
+		# still held, so pick it up unless a new worker already has
+		[ -f "$HOTPLUG_QUEUE" ] || break
+		lock -n "$HOTPLUG_WORKER_LOCK" 2>/dev/null || break
+	done
+}
+
+# one queue record: a subshell that restores the environment of this
+# event, DNSMASQ_* included, and runs its handlers
+hotplug_record() {
+	local var value
+
+	echo "("
+	for var in ACTION MACADDR IPADDR HOSTNAME \
+		$(env | sed -n 's/^\(DNSMASQ_[A-Za-z0-9_]*\)=.*/\1/p'); do
+		eval "[ -n \"\${$var+x}\" ]" || continue
+		eval "value=\"\$$var\""
+		[ "$var" = HOSTNAME -a -z "$value" ] && continue
+		printf "export %s='%s'\n" "$var" \
+			"$(printf '%s' "$value" | sed "s/'/'\\\\''/g")"
+	done
+	echo "hotplug_dispatch $1"
+	echo ")"
+}
+
+# queue the event and return to dnsmasq right away; a single worker
+# dispatches queued events in order instead of one hotplug-call per lease
+hotplug() {
+	has_handlers "$1" || exit 0
+
+	lock "$HOTPLUG_QUEUE_LOCK"
+	hotplug_record "$1" >> "$HOTPLUG_QUEUE"
+	lock -u "$HOTPLUG_QUEUE_LOCK"
+
+	lock -n "$HOTPLUG_WORKER_LOCK" 2>/dev/null || exit 0
+	hotplug_worker </dev/null >/dev/null 2>&1 &
+	exit 0
+}
+
 case "$1" in
 	add)
 		export ACTION="add"
 		export MACADDR="$2"
 		export IPADDR="$3"
 		export HOSTNAME="$4"
-		exec /sbin/hotplug-call dhcp
+		hotplug dhcp
 	;;
 	del)
 		export ACTION="remove"
 		export MACADDR="$2"
 		export IPADDR="$3"
 		export HOSTNAME="$4"
-		exec /sbin/hotplug-call dhcp
+		hotplug dhcp
 	;;
 	old)
 		export ACTION="update"
 		export MACADDR="$2"
 		export IPADDR="$3"
 		export HOSTNAME="$4"
-		exec /sbin/hotplug-call dhcp
+		hotplug dhcp
 	;;
 	arp-add)
 		export ACTION="add"
 		export MACADDR="$2"
 		export IPADDR="$3"
-		exec /sbin/hotplug-call neigh
+		hotplug neigh
 	;;
 	arp-del)
 		export ACTION="remove"
 		export MACADDR="$2"
 		export IPADDR="$3"
-		exec /sbin/hotplug-call neigh
+		hotplug neigh
 	;;
 	tftp)
 		export ACTION="add"
 		export TFTP_SIZE="$2"
 		export TFTP_ADDR="$3"
 		export TFTP_PATH="$4"
+		has_handlers tftp || exit 0
 		exec /sbin/hotplug-call tftp
 	;;
 esac
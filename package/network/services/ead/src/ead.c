@@ -252,7 +252,7 @@ hash_password:
 	/* x = H(s, H(u, ':', p)) */
 	x = BigIntegerFromBytes(dig, sizeof(dig));
 
-	BigIntegerModExp(v, g, x, n);
+	BigIntegerModExpBase(v, g, x, n);
 	tpe.password.len = BigIntegerToBytes(v, (unsigned char *)pwbuf);
 
 	BigIntegerFree(v);
@@ -679,6 +679,16 @@ handle_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *bytes)
 	parse_message(pkt, h->len);
 }
 
+/* send-only handles accept nothing, so the kernel does not fill their ring */
+static struct bpf_insn dropfilter_insns[] = {
+	BPF_STMT(BPF_RET+BPF_K, 0),
+};
+
+static struct bpf_program dropfilter = {
+	.bf_len = 1,
+	.bf_insns = dropfilter_insns,
+};
+
 static void
 ead_pcap_reopen(bool first)
 {
@@ -709,6 +719,8 @@ ead_pcap_reopen(bool first)
 			sleep(1);
 	} while (!pcap_fp);
 	pcap_setfilter(pcap_fp_rx, &pktfilter);
+	if (pcap_fp != pcap_fp_rx)
+		pcap_setfilter(pcap_fp, &dropfilter);
 }
 
 
@@ -716,7 +728,8 @@ static void
 ead_pktloop(void)
 {
 	while (1) {
-		if (pcap_dispatch(pcap_fp_rx, 1, handle_packet, NULL) < 0) {
+		/* drain everything the capture ring holds per wakeup */
+		if (pcap_dispatch(pcap_fp_rx, -1, handle_packet, NULL) < 0) {
 			ead_pcap_reopen(false);
 			continue;
 		}
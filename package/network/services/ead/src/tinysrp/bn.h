@@ -74,7 +74,7 @@ extern "C" {
 #undef BN_SQR_COMBA
 #undef BN_RECURSION
 #undef RECP_MUL_MOD
-#undef MONT_MUL_MOD
+#define MONT_MUL_MOD
 
 #if defined(SIZEOF_LONG_LONG) && SIZEOF_LONG_LONG == 8
 # if SIZEOF_LONG == 4
@@ -260,6 +260,22 @@ typedef struct bn_mont_ctx_st
 	int flags;
 	} BN_MONT_CTX;
 
+/* Used for fixed-base montgomery exponentiation */
+#define BN_MONT_BASE_WINDOW	4	/* exponent bits per table column */
+
+typedef struct bn_mont_base_st
+	{
+	BIGNUM g;      /* the base */
+	BN_MONT_CTX *mont;
+	int bits;      /* largest exponent the table covers */
+	int words;     /* size of a table entry, mont->N.top */
+	BN_ULONG *table; /* g^(k*2^(w*j)) for each column j and digit k */
+	int flags;
+	} BN_MONT_BASE;
+
+#define BN_MONT_BASE_SIZE(b) ((b)->bits/BN_MONT_BASE_WINDOW* \
+	(1<<BN_MONT_BASE_WINDOW)*(b)->words)
+
 /* Used for reciprocal division/mod functions
  * It cannot be shared between threads
  */
@@ -350,6 +366,14 @@ int     BN_mod_exp_mont(BIGNUM *r, BIGNUM *a, const BIGNUM *p,
 			const BIGNUM *m, BN_CTX *ctx, BN_MONT_CTX *m_ctx);
 int     BN_mod_exp_mont_word(BIGNUM *r, BN_ULONG a, const BIGNUM *p,
 			const BIGNUM *m, BN_CTX *ctx, BN_MONT_CTX *m_ctx);
+int     BN_mod_exp_mont_consttime(BIGNUM *r, BIGNUM *a, const BIGNUM *p,
+			const BIGNUM *m, BN_CTX *ctx, BN_MONT_CTX *m_ctx);
+int     BN_mod_exp_mont_base(BIGNUM *r, const BIGNUM *p, BN_MONT_BASE *base,
+			BN_CTX *ctx);
+int     BN_mod_exp_consttime(BIGNUM *r, BIGNUM *a, const BIGNUM *p,
+			const BIGNUM *m, BN_CTX *ctx);
+int     BN_mod_exp_base(BIGNUM *r, BIGNUM *g, const BIGNUM *p,
+			const BIGNUM *m, BN_CTX *ctx);
 int     BN_mod_exp_simple(BIGNUM *r, const BIGNUM *a, const BIGNUM *p,
 	const BIGNUM *m,BN_CTX *ctx);
 int     BN_mask_bits(BIGNUM *a,int n);
@@ -382,6 +406,12 @@ void BN_MONT_CTX_free(BN_MONT_CTX *mont);
 int BN_MONT_CTX_set(BN_MONT_CTX *mont,const BIGNUM *modulus,BN_CTX *ctx);
 BN_MONT_CTX *BN_MONT_CTX_copy(BN_MONT_CTX *to,BN_MONT_CTX *from);
 
+void BN_MONT_BASE_init(BN_MONT_BASE *base);
+BN_MONT_BASE *BN_MONT_BASE_new(void);
+void BN_MONT_BASE_free(BN_MONT_BASE *base);
+int BN_MONT_BASE_set(BN_MONT_BASE *base,const BIGNUM *g,const BIGNUM *m,
+		     int bits,BN_CTX *ctx);
+
 void BN_set_params(int mul,int high,int low,int mont);
 int BN_get_params(int which); /* 0, mul, 1 high, 2 low, 3 mont */
 
@@ -138,6 +138,27 @@ err:
 	return(r);
 	}
 
+#ifdef MONT_MUL_MOD
+/* SRP keeps exponentiating modulo the same prime, so hang on to the
+ * Montgomery setup of the last modulus */
+static BN_MONT_CTX *bn_mont_cached(const BIGNUM *m, BN_CTX *ctx)
+	{
+	static BN_MONT_CTX *mont = NULL;
+
+	if (mont == NULL || BN_cmp(&(mont->N),m) != 0)
+		{
+		if (mont == NULL && (mont=BN_MONT_CTX_new()) == NULL)
+			return(NULL);
+		if (!BN_MONT_CTX_set(mont,m,ctx))
+			{
+			BN_MONT_CTX_free(mont);
+			mont=NULL;
+			}
+		}
+	return(mont);
+	}
+#endif
+
 int BN_mod_exp(BIGNUM *r, BIGNUM *a, const BIGNUM *p, const BIGNUM *m,
 	       BN_CTX *ctx)
 	{
@@ -156,13 +177,11 @@ int BN_mod_exp(BIGNUM *r, BIGNUM *a, const BIGNUM *p, const BIGNUM *m,
 
 	if (BN_is_odd(m))
 		{
-		if (a->top == 1)
-			{
-			BN_ULONG A = a->d[0];
-			ret=BN_mod_exp_mont_word(r,A,p,m,ctx,NULL);
-			}
-		else
-			ret=BN_mod_exp_mont(r,a,p,m,ctx,NULL);
+		BN_MONT_CTX *mont;
+
+		if ((mont=bn_mont_cached(m,ctx)) == NULL)
+			return(0);
+		ret=BN_mod_exp_mont(r,a,p,m,ctx,mont);
 		}
 	else
 #endif
@@ -176,6 +195,58 @@ int BN_mod_exp(BIGNUM *r, BIGNUM *a, const BIGNUM *p, const BIGNUM *m,
 	}
 
 
+/* a^p % m for a secret exponent p */
+int BN_mod_exp_consttime(BIGNUM *r, BIGNUM *a, const BIGNUM *p,
+			 const BIGNUM *m, BN_CTX *ctx)
+	{
+	bn_check_top(a);
+	bn_check_top(p);
+	bn_check_top(m);
+
+#ifdef MONT_MUL_MOD
+	if (BN_is_odd(m))
+		{
+		BN_MONT_CTX *mont;
+
+		if ((mont=bn_mont_cached(m,ctx)) == NULL)
+			return(0);
+		return(BN_mod_exp_mont_consttime(r,a,p,m,ctx,mont));
+		}
+#endif
+	return(BN_mod_exp(r,a,p,m,ctx));
+	}
+
+/* g^p % m for a secret exponent p and a base that rarely changes, such
+ * as the SRP generator; the table for the last g and m is kept around */
+int BN_mod_exp_base(BIGNUM *r, BIGNUM *g, const BIGNUM *p, const BIGNUM *m,
+		    BN_CTX *ctx)
+	{
+	bn_check_top(g);
+	bn_check_top(p);
+	bn_check_top(m);
+
+#ifdef MONT_MUL_MOD
+	if (BN_is_odd(m))
+		{
+		static BN_MONT_BASE *base = NULL;
+
+		if (base == NULL && (base=BN_MONT_BASE_new()) == NULL)
+			return(0);
+		if (base->table == NULL ||
+		    BN_cmp(&(base->mont->N),m) != 0 ||
+		    BN_cmp(&(base->g),g) != 0 ||
+		    BN_num_bits(p) > base->bits)
+			{
+			if (!BN_MONT_BASE_set(base,g,m,
+			    (p->top > 0 ? p->top : 1)*BN_BITS2,ctx))
+				return(0);
+			}
+		return(BN_mod_exp_mont_base(r,p,base,ctx));
+		}
+#endif
+	return(BN_mod_exp(r,g,p,m,ctx));
+	}
+
 #ifdef RECP_MUL_MOD
 int BN_mod_exp_recp(BIGNUM *r, const BIGNUM *a, const BIGNUM *p,
 		    const BIGNUM *m, BN_CTX *ctx)
@@ -161,6 +161,10 @@ _TYPE( void ) BigIntegerModMul P((BigInteger result,
 				BigInteger m1, BigInteger m2, BigInteger m));
 _TYPE( void ) BigIntegerModExp P((BigInteger result, BigInteger base,
 				BigInteger expt, BigInteger modulus));
+_TYPE( void ) BigIntegerModExpSecret P((BigInteger result, BigInteger base,
+				BigInteger expt, BigInteger modulus));
+_TYPE( void ) BigIntegerModExpBase P((BigInteger result, BigInteger base,
+				BigInteger expt, BigInteger modulus));
 _TYPE( void ) BigIntegerModExpInt P((BigInteger result, BigInteger base,
 				   unsigned int expt, BigInteger modulus));
 _TYPE( int ) BigIntegerCheckPrime P((BigInteger n));
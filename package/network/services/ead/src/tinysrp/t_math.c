@@ -155,6 +155,26 @@ BigIntegerModExp(r, b, e, m)
   BN_CTX_free(ctx);
 }
 
+/* b^e % m where the exponent e is secret */
+void
+BigIntegerModExpSecret(r, b, e, m)
+     BigInteger r, b, e, m;
+{
+  BN_CTX * ctx = BN_CTX_new();
+  BN_mod_exp_consttime(r, b, e, m, ctx);
+  BN_CTX_free(ctx);
+}
+
+/* g^e % m for the group generator g and a secret exponent e */
+void
+BigIntegerModExpBase(r, g, e, m)
+     BigInteger r, g, e, m;
+{
+  BN_CTX * ctx = BN_CTX_new();
+  BN_mod_exp_base(r, g, e, m, ctx);
+  BN_CTX_free(ctx);
+}
+
 void
 BigIntegerModExpInt(r, b, e, m)
      BigInteger r, b;
@@ -0,0 +1,284 @@
+/*
+ * tinysrp-bench: known-answer tests for the modular exponentiation
+ * routines used by SRP, checked against fixed vectors and against the
+ * plain square-and-multiply BN_mod_exp_simple(), followed by a count of
+ * complete client/server handshakes per second for each built-in group.
+ *
+ * Built on request only ("make tinysrp-bench"); it is not installed.
+ */
+
+#include <stdio.h>
+#include "t_defines.h"
+#include "t_pwd.h"
+#include "t_client.h"
+#include "t_server.h"
+#include "bn.h"
+
+#define RANDOM_ROUNDS	16
+
+/* index (1-origin, as in t_getpreparam() + 1), base, exponent, result */
+static const struct kat {
+  int index;
+  const char * base;
+  const char * expt;
+  const char * result;
+} kats[] = {
+  { 5,
+    "2",
+    "f4bb70700063c0f39081a20f600c16e2bd4168242d7fe14dad9f1a66363434df",
+    "98b4df85f2d7b7466181962156b2d786558e337ee29360f5e2f71627452361dd"
+    "fe29cc1a7359d995d9e3f077b21c4fb45d4a3358e16868238cf32b4e8cac9609"
+    "b0a4a830a4d7ddb97564b300aa2828bf0a62c094eb28a3f3ea1ae07ef84a4603"
+    "a50d04203178997973ab283b29feb6741e1485fdf48e05a8abec614d9d7f2710" },
+  { 5,
+    "4c4df6beebf89433a6102db44f235dc779939e036ddacdc9bf5985fb87d930b4"
+    "a14444a924de732206bf61bd22d477d763162d4030b9710df3421d635ab8144b"
+    "eefb759b41c4600e0225ebc36ca1122e495498b75e0a958f58a7f0b623e0e8a9"
+    "04b970b57d66566a05c4fa9f435940b4d60078ca5b1cd706a17f69053ced41e3",
+    "99a10ee148d810bd3a2a92d12fce5498a50ac3cfc51e5dc6f2b77430c0b43dc3"
+    "2c7c1a727ad282aaae5b102dd7e4e463fae22dd5",
+    "538e7f5fb132c695992ef955d4f6213b0f970f60a4a0eac2065f56cd85d30114"
+    "9c1f5a9cea5166f18a51ff38a3b90588c117cb8d7161f199da91f28a2268baaf"
+    "11b9fb6f97ce64f005be9de984ef01d248c59d4f687d98f1d849ec99306dfc30"
+    "f524ab13afad283a68c48aab0f2661d2977f19ee9b5ca0b3f69acd31cdd81f3c" },
+  { 1,
+    "2",
+    "e78c4249380dee4ef96860f5a7ed4aba4361fa78b6c284288faabe26660abe72",
+    "52d5a3cb9ef0f537207a85f196dc13abf526b55286a452b113baec0081921a30"
+    "faee369d8687b04b7a6e721badfe608262bf92b5348858dca42ec101896ff2b5"
+    "a2aa32df3b3bf64142c6c886b60e8546c84c81fff377c0e8e976a13e6d06d4b0"
+    "4056b2ead965d1e38f6b0009d4ba85e0b1895e0d830d666091d7ab76213d6f6e"
+    "eff08d616ec99ddcc6c84eac8932bd1f933440fde8dbc46cdb111b3a3c8afe6c"
+    "38d571aa4d04766f8cb7ad15ea9d8d7a1f1a412e968c056fe09108ac4a12dd74"
+    "65135c2a4cef74c23f519c79ee52f1ab2e5882c61c279a65aedde8f2aaafd199"
+    "34ca574293bec815a29488f8148c43c02ac95e7130720e99d1fafeabe7dc36d1" },
+  { 1,
+    "49e55f07f0616afe0d77da869563af08d1ed71a6cc341cf8e34058d096cc8b5f"
+    "2f0e81c94b36fe4bff3558475989b39c6f9597c5ebf19533fd22ec62a89b5a8f"
+    "6f7d9bec383f804abac9ba38b3dee868e0f091df8b6af974bbf7acdb201c57b6"
+    "3fde4fdbb0a6c4e10207fda84ced40dc818ec4e911612bdb2a183070c5694e0e"
+    "d9d748d0f481dfc0fd4799a5b184173d81646c4791f25c64037ab4343d07bb61"
+    "1f01671dbb4ad1fba88dbbcf918337de2562f7a2e40f31bea10d9a3c23789379"
+    "e6c2c9f00d2c219c9fa141008687687109cf48c47e85cfbbb768fbeb7a2923c0"
+    "e2a7dbf7ff481690b318a1296ead1f790d19257273d72f9ebe792589170a89ec",
+    "fae5617d82f16cfe10781156b270fe38536501b1a0e76f6733288dbfa916316b"
+    "2c7c1a727ad282aaae5b102dd7e4e463fae22dd5",
+    "98be5411d3f49af7ed8fe3fafdcf13165633877e090a6c841614ef78c779f12f"
+    "64b192ef634e245671b6892378caf976599653c90f163c8eba849a474fdf257b"
+    "7c586402eacf583084a6ae433fd30960c0df1ed13db3d012432159af2c220808"
+    "afe42c6ef21d41527812dab72c18e723c3154941c62d74ff169f005bad26b47d"
+    "f9c6964f2c3a121d75217174cc9f3a9daf570f89f122f377a6a8b90edced9d1f"
+    "7e1c12f6fa481452d8b13f3315917d8e19ba0f61fd0dcb852b78a44dba161cb3"
+    "7ba11e8641ca7f0de0d4c273d4882ee9d039e93e5c6d2320837ff5526e163fa4"
+    "573e5f8ff3f63bff4c486a3f23b8fd9b468fb71482f3e15fa2538d4359319d37" },
+};
+
+static BIGNUM *
+hex2bn(s)
+     const char * s;
+{
+  unsigned char buf[MAXPARAMLEN + 1];
+  int len;
+
+  len = t_fromhex((char *) buf, (char *) s);
+  return BN_bin2bn(buf, len, NULL);
+}
+
+static BIGNUM *
+modulus(index)
+     int index;
+{
+  struct t_preconf * tcp = t_getpreparam(index - 1);
+
+  return BN_bin2bn(tcp->modulus.data, tcp->modulus.len, NULL);
+}
+
+/* random exponent of up to bits bits */
+static BIGNUM *
+random_expt(bits)
+     int bits;
+{
+  unsigned char buf[MAXPARAMLEN];
+  int len = (bits + 7) / 8;
+
+  if(len == 0)
+    return BN_new();
+  t_random(buf, len);
+  if(bits % 8)
+    buf[0] &= (1 << (bits % 8)) - 1;
+  return BN_bin2bn(buf, len, NULL);
+}
+
+/* compute b^e % n every way we know, compare with ref if given */
+static int
+check_expt(name, b, e, n, ref, ctx)
+     const char * name;
+     BIGNUM * b, * e, * n, * ref;
+     BN_CTX * ctx;
+{
+  BIGNUM * r[4];
+  static const char * how[4] = { "simple", "mont", "consttime", "base" };
+  int i, fail = 0;
+
+  for(i = 0; i < 4; ++i)
+    r[i] = BN_new();
+  BN_mod_exp_simple(r[0], b, e, n, ctx);
+  BN_mod_exp_mont(r[1], b, e, n, ctx, NULL);
+  BN_mod_exp_consttime(r[2], b, e, n, ctx);
+  BN_mod_exp_base(r[3], b, e, n, ctx);
+
+  if(ref == NULL)
+    ref = r[0];
+  for(i = 0; i < 4; ++i)
+    if(BN_cmp(r[i], ref) != 0) {
+      fprintf(stderr, "%s: %s mismatch (%d bit modulus, %d bit exponent)\n",
+	      name, how[i], BN_num_bits(n), BN_num_bits(e));
+      fail = 1;
+    }
+
+  for(i = 0; i < 4; ++i)
+    BN_free(r[i]);
+  return fail;
+}
+
+static int
+run_kats()
+{
+  BN_CTX * ctx = BN_CTX_new();
+  BIGNUM * n, * g, * b, * e, * r;
+  int i, j, fail = 0;
+
+  for(i = 0; i < sizeof(kats) / sizeof(kats[0]); ++i) {
+    n = modulus(kats[i].index);
+    b = hex2bn(kats[i].base);
+    e = hex2bn(kats[i].expt);
+    r = hex2bn(kats[i].result);
+    fail |= check_expt("kat", b, e, n, r, ctx);
+    BN_free(r);
+    BN_free(e);
+    BN_free(b);
+    BN_free(n);
+  }
+
+  for(i = 0; i < t_getprecount(); ++i) {
+    struct t_preconf * tcp = t_getpreparam(i);
+
+    n = modulus(i + 1);
+    g = BN_bin2bn(tcp->generator.data, tcp->generator.len, NULL);
+    for(j = 0; j < RANDOM_ROUNDS; ++j) {
+      /* from empty exponents up to the size of a + u * x */
+      e = random_expt(j * (8 * ALEN + 8 * SHA_DIGESTSIZE) / RANDOM_ROUNDS);
+      fail |= check_expt("g^e", g, e, n, NULL, ctx);
+      b = random_expt(BN_num_bits(n) - 1);
+      fail |= check_expt("b^e", b, e, n, NULL, ctx);
+      BN_free(b);
+      BN_free(e);
+    }
+    BN_free(g);
+    BN_free(n);
+  }
+
+  BN_CTX_free(ctx);
+  return fail;
+}
+
+/* one complete SRP exchange, as ead and ead-client do it */
+static int
+handshake(index)
+     int index;
+{
+  struct t_preconf * tcp = t_getpreparam(index - 1);
+  struct t_client * tc;
+  struct t_server * ts;
+  struct t_pwent pwent;
+  struct t_confent tce;
+  struct t_num s, * A, * B;
+  unsigned char saltbuf[SALTLEN];
+  unsigned char * ckey, * skey;
+  int fail = 1;
+
+  t_random(saltbuf, sizeof(saltbuf));
+  s.data = saltbuf;
+  s.len = sizeof(saltbuf);
+
+  tc = t_clientopen("bench", &tcp->modulus, &tcp->generator, &s);
+  if(tc == NULL)
+    return 1;
+  A = t_clientgenexp(tc);
+  t_clientpasswd(tc, "password");
+
+  pwent.name = "bench";
+  pwent.password = tc->v;
+  pwent.salt = s;
+  pwent.index = index;
+  tce.index = index;
+  tce.modulus = tcp->modulus;
+  tce.generator = tcp->generator;
+  ts = t_serveropenraw(&pwent, &tce);
+  if(ts == NULL)
+    goto out;
+  B = t_servergenexp(ts);
+
+  skey = t_servergetkey(ts, A);
+  ckey = t_clientgetkey(tc, B);
+  if(skey == NULL || ckey == NULL ||
+     memcmp(skey, ckey, SESSION_KEY_LEN) != 0)
+    goto out_server;
+  if(t_serververify(ts, t_clientresponse(tc)) != 0)
+    goto out_server;
+  if(t_clientverify(tc, t_serverresponse(ts)) != 0)
+    goto out_server;
+  fail = 0;
+
+out_server:
+  t_serverclose(ts);
+out:
+  t_clientclose(tc);
+  return fail;
+}
+
+static double
+now()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int
+main(argc, argv)
+     int argc;
+     char * argv[];
+{
+  double seconds = 2.0, start, elapsed;
+  int i, count, fail;
+
+  if(argc > 1)
+    seconds = atof(argv[1]);
+
+  fail = run_kats();
+  printf("known-answer tests: %s\n", fail ? "FAILED" : "passed");
+
+  for(i = 1; i <= t_getprecount(); ++i) {
+    struct t_preconf * tcp = t_getpreparam(i - 1);
+
+    if(handshake(i) != 0) {
+      printf("group %d: handshake FAILED\n", i);
+      fail = 1;
+      continue;
+    }
+
+    count = 0;
+    start = now();
+    do {
+      fail |= handshake(i);
+      ++count;
+    } while((elapsed = now() - start) < seconds);
+
+    printf("group %d (%d bits): %.1f handshakes/sec\n",
+	   i, tcp->modulus.len * 8, count / elapsed);
+  }
+
+  return fail;
+}
@@ -243,7 +243,7 @@ t_makepwent(tpw, user, pass, salt, confent)
   /* x = H(s, H(u, ':', p)) */
   x = BigIntegerFromBytes(dig, sizeof(dig));
 
-  BigIntegerModExp(v, g, x, n);
+  BigIntegerModExpBase(v, g, x, n);
   tpw->pebuf.password.len = BigIntegerToBytes(v, tpw->pebuf.password.data);
 
   BigIntegerFree(v);
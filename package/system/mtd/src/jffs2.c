@@ -97,6 +97,42 @@ static void prep_eraseblock(void)
 	add_data(CLEANMARKER, sizeof(CLEANMARKER) - 1);
 }
 
+/*
+ * Same algorithm as the kernel's rtime compressor, which unlike zlib and
+ * lzo is enabled in every target config. Returns the compressed size, or
+ * 0 if the data does not get smaller.
+ */
+static int rtime_compress(const unsigned char *in, unsigned char *out, int len)
+{
+	unsigned short positions[256];
+	int outpos = 0, pos = 0;
+
+	memset(positions, 0, sizeof(positions));
+
+	while (pos < len && outpos <= len - 3) {
+		int backpos, runlen = 0;
+		unsigned char value;
+
+		value = in[pos];
+		out[outpos++] = in[pos++];
+
+		backpos = positions[value];
+		positions[value] = pos;
+
+		while ((backpos < pos) && (pos < len) &&
+		       (in[pos] == in[backpos++]) && (runlen < 255)) {
+			pos++;
+			runlen++;
+		}
+		out[outpos++] = runlen;
+	}
+
+	if (pos < len || outpos >= len)
+		return 0;
+
+	return outpos;
+}
+
 static int add_dirent(const char *name, const char type, int parent)
 {
 	struct jffs2_raw_dirent *de;
@@ -165,7 +201,7 @@ static void add_file(const char *name, int parent)
 	int inode, f_offset = 0, fd;
 	struct jffs2_raw_inode ri;
 	struct stat st;
-	char wbuf[4096];
+	unsigned char wbuf[4096], *data;
 	const char *fname;
 
 	if (stat(name, &st)) {
@@ -191,7 +227,6 @@ static void add_file(const char *name, int parent)
 	ri.ctime = st.st_ctime;
 	ri.mtime = st.st_mtime;
 	ri.isize = st.st_size;
-	ri.compr = 0;
 	ri.usercompr = 0;
 
 	fd = open(name, 0);
@@ -219,16 +254,28 @@ static void add_file(const char *name, int parent)
 		if (len <= 0)
 			break;
 
-		ri.totlen = sizeof(ri) + len;
+		/* the node fits into the current eraseblock, so build the
+		 * payload in place instead of copying it in afterwards */
+		data = (unsigned char *) buf + ofs + sizeof(ri);
+		ri.dsize = len;
+		ri.csize = rtime_compress(wbuf, data, len);
+		if (ri.csize) {
+			ri.compr = JFFS2_COMPR_RTIME;
+		} else {
+			ri.compr = JFFS2_COMPR_NONE;
+			ri.csize = len;
+			memcpy(data, wbuf, len);
+		}
+
+		ri.totlen = sizeof(ri) + ri.csize;
 		ri.hdr_crc = crc32(0, &ri, sizeof(struct jffs2_unknown_node) - 4);
 		ri.version = ++last_version;
 		ri.offset = f_offset;
-		ri.csize = ri.dsize = len;
 		ri.node_crc = crc32(0, &ri, sizeof(ri) - 8);
-		ri.data_crc = crc32(0, wbuf, len);
+		ri.data_crc = crc32(0, data, ri.csize);
 		f_offset += len;
-		add_data((char *) &ri, sizeof(ri));
-		add_data(wbuf, len);
+		memcpy(buf + ofs, &ri, sizeof(ri));
+		ofs += ri.totlen;
 		pad(4);
 		prep_eraseblock();
 	}
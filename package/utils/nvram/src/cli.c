@@ -142,7 +142,9 @@ static void usage(void)
 		"	nvram get variable\n"
 		"	nvram set variable=value [set ...]\n"
 		"	nvram unset variable [unset ...]\n"
-		"	nvram commit\n"
+		"	nvram [-v] commit\n"
+		"\n"
+		"	-v	report the number of bytes written to flash\n"
 	);
 }
 
@@ -150,11 +152,19 @@ int main( int argc, const char *argv[] )
 {
 	nvram_handle_t *nvram;
 	int commit = 0;
+	int verbose = 0;
 	int write = 0;
 	int stat = 1;
 	int done = 0;
 	int i;
 
+	if( argc > 1 && !strcmp(argv[1], "-v") )
+	{
+		verbose = 1;
+		argv++;
+		argc--;
+	}
+
 	if( argc < 2 ) {
 		usage();
 		return 1;
@@ -228,8 +238,8 @@ int main( int argc, const char *argv[] )
 
 		nvram_close(nvram);
 
-		if( commit )
-			stat = staging_to_nvram();
+		if( commit && !(stat = staging_to_nvram()) && verbose )
+			fprintf(stderr, "Wrote %zu bytes to flash\n", nvram_commit_bytes);
 	}
 
 	if( !nvram )
@@ -21,6 +21,9 @@
 /* Size of "nvram" MTD partition */
 size_t nvram_part_size = 0;
 
+/* Bytes written to flash by the last commit */
+size_t nvram_commit_bytes = 0;
+
 
 /*
  * -- Helper functions --
@@ -511,10 +514,65 @@ int nvram_to_staging(void)
 	return stat;
 }
 
+/*
+ * Write a full partition image through the MTD character device that
+ * belongs to the given mtdblock node, erasing and programming only the
+ * eraseblocks whose contents differ from what is on flash.
+ * Returns the number of bytes written or -1 if the device can't be used.
+ */
+static int staging_to_mtd(const char *mtdblock, const char *buf)
+{
+	struct mtd_info_user info;
+	struct erase_info_user erase;
+	char dev[PATH_MAX];
+	char *old;
+	int fd, i, written;
+
+	if( sscanf(mtdblock, "/dev/mtdblock%d", &i) != 1 )
+		return -1;
+
+	snprintf(dev, sizeof(dev), "/dev/mtd%d", i);
+
+	if( (fd = open(dev, O_RDWR | O_SYNC)) < 0 )
+		return -1;
+
+	if( ioctl(fd, MEMGETINFO, &info) || (info.erasesize == 0) ||
+	    (nvram_part_size % info.erasesize) ||
+	    (old = malloc(info.erasesize)) == NULL )
+	{
+		close(fd);
+		return -1;
+	}
+
+	written = 0;
+	erase.length = info.erasesize;
+
+	for( erase.start = 0; erase.start < nvram_part_size; erase.start += erase.length )
+	{
+		if( (pread(fd, old, erase.length, erase.start) == erase.length) &&
+		    !memcmp(old, buf + erase.start, erase.length) )
+			continue;
+
+		if( ioctl(fd, MEMERASE, &erase) ||
+		    (pwrite(fd, buf + erase.start, erase.length, erase.start) != erase.length) )
+		{
+			written = -1;
+			break;
+		}
+
+		written += erase.length;
+	}
+
+	free(old);
+	close(fd);
+
+	return written;
+}
+
 /* Copy staging file to NVRAM device. */
 int staging_to_nvram(void)
 {
-	int fdmtd, fdstg, stat;
+	int fdmtd, fdstg, stat, written;
 	char *mtd = nvram_find_mtd();
 	char buf[nvram_part_size];
 
@@ -526,11 +584,17 @@ int staging_to_nvram(void)
 		{
 			if( read(fdstg, buf, sizeof(buf)) == sizeof(buf) )
 			{
-				if( (fdmtd = open(mtd, O_WRONLY | O_SYNC)) > -1 )
+				if( (written = staging_to_mtd(mtd, buf)) > -1 )
+				{
+					nvram_commit_bytes = written;
+					stat = 0;
+				}
+				else if( (fdmtd = open(mtd, O_WRONLY | O_SYNC)) > -1 )
 				{
 					write(fdmtd, buf, sizeof(buf));
 					fsync(fdmtd);
 					close(fdmtd);
+					nvram_commit_bytes = sizeof(buf);
 					stat = 0;
 				}
 			}
@@ -24,7 +24,9 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <linux/limits.h>
+#include <mtd/mtd-user.h>
 
 #include "sdinitvals.h"
 
@@ -99,6 +101,9 @@ int nvram_to_staging(void);
 /* Copy staging file to NVRAM device. */
 int staging_to_nvram(void);
 
+/* Bytes written to flash by the last staging_to_nvram(). */
+extern size_t nvram_commit_bytes;
+
 /* Check NVRAM staging file. */
 char * nvram_find_staging(void);
 
@@ -308,7 +308,9 @@ TARGET_CONFIGURE_OPTS = \
   OBJDUMP=$(TARGET_CROSS)objdump \
   SIZE=$(TARGET_CROSS)size
 
-# strip an entire directory
+# strip an entire directory; files are stripped one at a time unless
+# RSTRIP_JOBS is set (the recipes are not marked '+', so that make -n
+# does not run them, and therefore get no jobserver)
 ifneq ($(CONFIG_NO_STRIP),)
   RSTRIP:=:
   STRIP:=:
@@ -328,8 +330,10 @@ else
     NM="$(TARGET_CROSS)nm" \
     STRIP="$(STRIP)" \
     STRIP_KMOD="$(SCRIPT_DIR)/strip-kmod.sh" \
+    STRIP_KMOD_CACHE="$(BUILD_DIR)/strip-kmod-cache" \
+    MKHASH="$(STAGING_DIR_HOST)/bin/mkhash" \
     PATCHELF="$(STAGING_DIR_HOST)/bin/patchelf" \
-    $(SCRIPT_DIR)/rstrip.sh
+    $(STAGING_DIR_HOST)/bin/rstrip $(if $(RSTRIP_JOBS),-j $(RSTRIP_JOBS))
 endif
 
 ifeq ($(CONFIG_IPV6),y)
@@ -0,0 +1,89 @@
+#!/usr/bin/env bash
+#
+# Resolve the files needed by the sysupgrade ramfs in a target root: the
+# programs listed in lib/upgrade/ramfs.binaries, the symlinks leading to
+# them, their program interpreter and the shared libraries they need.
+# Paths are printed relative to the root, one per line.
+#
+# usage: ramfs-manifest.sh <root dir> [<PATH>]
+
+root="$1"
+search_path="${2:-/usr/sbin:/sbin:/usr/bin:/bin}"
+READELF="${READELF:-readelf}"
+
+if [ ! -f "$root/lib/upgrade/ramfs.binaries" ]; then
+	echo "Usage: $0 <root dir> [<PATH>]" >&2
+	exit 1
+fi
+
+"$READELF" --version >/dev/null 2>&1 || {
+	echo "ramfs-manifest: $READELF not found" >&2
+	exit 1
+}
+
+declare -A seen scanned
+
+emit() {
+	[ -n "${seen[$1]}" ] && return
+	seen[$1]=1
+	echo "${1#/}"
+}
+
+# follow symlinks inside the root, leaves the final path in $resolved
+resolve() {
+	local file="$1" link n=0
+
+	while [ -L "$root$file" ] && [ $n -lt 32 ]; do
+		emit "$file"
+		link="$(readlink "$root$file")"
+		case "$link" in
+			/*) file="$link";;
+			*) file="${file%/*}/$link";;
+		esac
+		file="$(realpath -ms "$file")"
+		n=$((n + 1))
+	done
+	resolved="$file"
+	[ -e "$root$file" ] && emit "$file"
+}
+
+scan_elf() {
+	local file="$1" info lib dir interp
+
+	[ -n "${scanned[$file]}" ] && return
+	scanned[$file]=1
+	[ -f "$root$file" ] || return
+
+	info="$("$READELF" -l -d "$root$file" 2>/dev/null)" || return
+	interp="$(echo "$info" | sed -n 's/.*program interpreter: \(.*\)\]$/\1/p')"
+	[ -n "$interp" ] && resolve "$interp"
+
+	for lib in $(echo "$info" | sed -n 's/.*Shared library: \[\(.*\)\]$/\1/p'); do
+		for dir in /lib /usr/lib; do
+			[ -e "$root$dir/$lib" ] || continue
+			resolve "$dir/$lib"
+			scan_elf "$resolved"
+			break
+		done
+	done
+}
+
+IFS=: read -ra path_dirs <<< "$search_path"
+
+while read -r binary; do
+	file=
+	case "$binary" in
+		"") continue;;
+		/*) file="$binary";;
+		*)
+			for dir in "${path_dirs[@]}"; do
+				[ -e "$root$dir/$binary" -o -L "$root$dir/$binary" ] || continue
+				file="$dir/$binary"
+				break
+			done
+		;;
+	esac
+	[ -n "$file" ] && [ -e "$root$file" -o -L "$root$file" ] || continue
+	resolve "$file"
+	scan_elf "$resolved"
+done < "$root/lib/upgrade/ramfs.binaries"
@@ -0,0 +1,597 @@
+/*
+ * rstrip - strip ELF files below a set of directories
+ *
+ * This is a native replacement for the main loop of rstrip.sh: the ELF
+ * type is taken from the file header instead of running file(1), rpaths
+ * are filtered in-process (with the same in-place semantics as
+ * patchelf --set-rpath when shrinking), and files are processed in
+ * parallel, taking job slots from the make jobserver if one is available.
+ *
+ * This is free software, licensed under the GNU General Public License v2.
+ * See /LICENSE for more information.
+ */
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <ftw.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *self = "rstrip.sh";
+static const char *strip_cmd;
+static const char *strip_kmod_cmd;
+static bool fix_rpath;
+
+static int max_jobs = 1;
+static int running;
+static int js_rfd = -1, js_wfd = -1;
+static char *js_tokens;
+static int js_held;
+
+struct elf_file {
+	uint8_t *data;
+	size_t len;
+	bool is64;
+	bool swap;
+};
+
+static uint16_t e16(struct elf_file *e, uint16_t v)
+{
+	return e->swap ? (uint16_t) ((v >> 8) | (v << 8)) : v;
+}
+
+static uint32_t e32(struct elf_file *e, uint32_t v)
+{
+	return e->swap ? __builtin_bswap32(v) : v;
+}
+
+static uint64_t e64(struct elf_file *e, uint64_t v)
+{
+	return e->swap ? __builtin_bswap64(v) : v;
+}
+
+static bool in_range(struct elf_file *e, uint64_t ofs, uint64_t len)
+{
+	return ofs <= e->len && len <= e->len - ofs;
+}
+
+static const char *elf_type(const uint8_t *hdr, size_t len)
+{
+	uint16_t type;
+
+	if (len < EI_NIDENT + 2 || memcmp(hdr, ELFMAG, SELFMAG) != 0)
+		return NULL;
+
+	if (hdr[EI_CLASS] != ELFCLASS32 && hdr[EI_CLASS] != ELFCLASS64)
+		return NULL;
+
+	switch (hdr[EI_DATA]) {
+	case ELFDATA2LSB:
+		type = hdr[EI_NIDENT] | (hdr[EI_NIDENT + 1] << 8);
+		break;
+	case ELFDATA2MSB:
+		type = (hdr[EI_NIDENT] << 8) | hdr[EI_NIDENT + 1];
+		break;
+	default:
+		return NULL;
+	}
+
+	switch (type) {
+	case ET_EXEC:
+		return "executable";
+	case ET_DYN:
+		return "shared object";
+	case ET_REL:
+		return "relocatable";
+	default:
+		return NULL;
+	}
+}
+
+/* Locate the string table entry the dynamic linker uses as search path */
+static bool find_rpath(struct elf_file *e, uint64_t *str_ofs,
+		       uint64_t *tag_ofs, bool *convert)
+{
+	uint64_t shoff, sh_dyn = 0, dyn_ofs = 0, dyn_size = 0;
+	uint64_t str_base = 0, str_size = 0;
+	uint64_t rpath_tag = 0, runpath_tag = 0;
+	uint64_t rpath_val = 0, runpath_val = 0;
+	unsigned int shnum, shentsize, i, link = 0;
+	bool found = false;
+
+	if (e->is64) {
+		Elf64_Ehdr *eh = (Elf64_Ehdr *) e->data;
+
+		if (!in_range(e, 0, sizeof(*eh)))
+			return false;
+		shoff = e64(e, eh->e_shoff);
+		shnum = e16(e, eh->e_shnum);
+		shentsize = e16(e, eh->e_shentsize);
+		if (shentsize < sizeof(Elf64_Shdr))
+			return false;
+	} else {
+		Elf32_Ehdr *eh = (Elf32_Ehdr *) e->data;
+
+		if (!in_range(e, 0, sizeof(*eh)))
+			return false;
+		shoff = e32(e, eh->e_shoff);
+		shnum = e16(e, eh->e_shnum);
+		shentsize = e16(e, eh->e_shentsize);
+		if (shentsize < sizeof(Elf32_Shdr))
+			return false;
+	}
+
+	if (!shoff || !in_range(e, shoff, (uint64_t) shnum * shentsize))
+		return false;
+
+	for (i = 0; i < shnum && !found; i++) {
+		uint8_t *sh = e->data + shoff + (uint64_t) i * shentsize;
+
+		if (e->is64) {
+			Elf64_Shdr *s = (Elf64_Shdr *) sh;
+
+			if (e32(e, s->sh_type) != SHT_DYNAMIC)
+				continue;
+			dyn_ofs = e64(e, s->sh_offset);
+			dyn_size = e64(e, s->sh_size);
+			link = e32(e, s->sh_link);
+		} else {
+			Elf32_Shdr *s = (Elf32_Shdr *) sh;
+
+			if (e32(e, s->sh_type) != SHT_DYNAMIC)
+				continue;
+			dyn_ofs = e32(e, s->sh_offset);
+			dyn_size = e32(e, s->sh_size);
+			link = e32(e, s->sh_link);
+		}
+		sh_dyn = i;
+		found = true;
+	}
+
+	if (!found || link >= shnum || link == sh_dyn ||
+	    !in_range(e, dyn_ofs, dyn_size))
+		return false;
+
+	if (e->is64) {
+		Elf64_Shdr *s = (Elf64_Shdr *) (e->data + shoff + (uint64_t) link * shentsize);
+
+		str_base = e64(e, s->sh_offset);
+		str_size = e64(e, s->sh_size);
+	} else {
+		Elf32_Shdr *s = (Elf32_Shdr *) (e->data + shoff + (uint64_t) link * shentsize);
+
+		str_base = e32(e, s->sh_offset);
+		str_size = e32(e, s->sh_size);
+	}
+
+	if (!in_range(e, str_base, str_size))
+		return false;
+
+	for (i = 0; ; i++) {
+		uint64_t ofs, tag, val;
+
+		if (e->is64) {
+			Elf64_Dyn *d;
+
+			ofs = dyn_ofs + (uint64_t) i * sizeof(*d);
+			if (ofs + sizeof(*d) > dyn_ofs + dyn_size)
+				break;
+			d = (Elf64_Dyn *) (e->data + ofs);
+			tag = e64(e, d->d_tag);
+			val = e64(e, d->d_un.d_val);
+		} else {
+			Elf32_Dyn *d;
+
+			ofs = dyn_ofs + (uint64_t) i * sizeof(*d);
+			if (ofs + sizeof(*d) > dyn_ofs + dyn_size)
+				break;
+			d = (Elf32_Dyn *) (e->data + ofs);
+			tag = e32(e, d->d_tag);
+			val = e32(e, d->d_un.d_val);
+		}
+
+		if (tag == DT_NULL)
+			break;
+
+		if (tag == DT_RPATH) {
+			rpath_tag = ofs;
+			rpath_val = val;
+		} else if (tag == DT_RUNPATH) {
+			runpath_tag = ofs;
+			runpath_val = val;
+		}
+	}
+
+	/* DT_RUNPATH takes precedence, a lone DT_RPATH gets converted */
+	if (runpath_tag) {
+		*str_ofs = runpath_val;
+		*tag_ofs = runpath_tag;
+		*convert = false;
+	} else if (rpath_tag) {
+		*str_ofs = rpath_val;
+		*tag_ofs = rpath_tag;
+		*convert = true;
+	} else {
+		return false;
+	}
+
+	if (*str_ofs >= str_size ||
+	    !memchr(e->data + str_base + *str_ofs, 0, str_size - *str_ofs))
+		return false;
+
+	*str_ofs += str_base;
+	return true;
+}
+
+static bool keep_rpath(const char *path)
+{
+	return !fnmatch("/lib/[!/]*", path, 0) ||
+	       !fnmatch("/usr/lib/[!/]*", path, 0) ||
+	       !fnmatch("$ORIGIN/*", path, 0);
+}
+
+static int fixup_rpath(const char *file)
+{
+	struct elf_file e = {};
+	uint64_t str_ofs, tag_ofs;
+	bool convert;
+	char *old_rpath, *new_rpath, *p, *next;
+	size_t old_len, new_len = 0;
+	struct stat st;
+	int fd, ret = 0;
+
+	fd = open(file, O_RDWR);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s: %s\n", self, file, strerror(errno));
+		goto out;
+	}
+
+	e.len = st.st_size;
+	if (e.len < EI_NIDENT)
+		goto out;
+
+	e.data = mmap(NULL, e.len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (e.data == MAP_FAILED) {
+		e.data = NULL;
+		goto out;
+	}
+
+	e.is64 = e.data[EI_CLASS] == ELFCLASS64;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	e.swap = e.data[EI_DATA] == ELFDATA2LSB;
+#else
+	e.swap = e.data[EI_DATA] == ELFDATA2MSB;
+#endif
+
+	if (!find_rpath(&e, &str_ofs, &tag_ofs, &convert))
+		goto out;
+
+	old_rpath = (char *) e.data + str_ofs;
+	old_len = strlen(old_rpath);
+	if (!old_len)
+		goto out;
+
+	p = strdup(old_rpath);
+	new_rpath = calloc(1, old_len + 1);
+	if (!p || !new_rpath) {
+		ret = -1;
+		goto free;
+	}
+
+	for (old_rpath = p; old_rpath; old_rpath = next) {
+		next = strchr(old_rpath, ':');
+		if (next)
+			*next++ = 0;
+
+		if (!keep_rpath(old_rpath)) {
+			printf("%s: %s: removing rpath %s\n", self, file, old_rpath);
+			continue;
+		}
+
+		if (new_len)
+			new_rpath[new_len++] = ':';
+		strcpy(new_rpath + new_len, old_rpath);
+		new_len += strlen(old_rpath);
+	}
+
+	if (new_len == old_len)
+		goto free;
+
+	/*
+	 * Same result as patchelf --set-rpath with a shorter path: the old
+	 * string is overwritten with 'X', the new one is copied over it and
+	 * a DT_RPATH without DT_RUNPATH is turned into DT_RUNPATH.
+	 */
+	memset(p, 'X', old_len);
+	memcpy(p, new_rpath, new_len + 1);
+	if (pwrite(fd, p, old_len, str_ofs) != (ssize_t) old_len)
+		ret = -1;
+
+	if (convert) {
+		uint64_t tag = DT_RUNPATH;
+		uint32_t tag32 = DT_RUNPATH;
+
+		if (e.is64) {
+			tag = e64(&e, tag);
+			if (pwrite(fd, &tag, sizeof(tag), tag_ofs) != sizeof(tag))
+				ret = -1;
+		} else {
+			tag32 = e32(&e, tag32);
+			if (pwrite(fd, &tag32, sizeof(tag32), tag_ofs) != sizeof(tag32))
+				ret = -1;
+		}
+	}
+
+	if (ret)
+		fprintf(stderr, "%s: %s: failed to update rpath\n", self, file);
+
+free:
+	free(p);
+	free(new_rpath);
+out:
+	if (e.data)
+		munmap(e.data, e.len);
+	if (fd >= 0)
+		close(fd);
+	return ret;
+}
+
+static int run_cmd(const char *cmd, const char *file)
+{
+	char *script;
+	int status;
+	pid_t pid;
+
+	if (asprintf(&script, "%s \"$1\"", cmd) < 0)
+		return -1;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0) {
+		execl("/bin/sh", "sh", "-c", script, "sh", file, NULL);
+		_exit(127);
+	}
+	free(script);
+
+	if (pid < 0 || waitpid(pid, &status, 0) < 0)
+		return -1;
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void process_file(const char *file, const char *type)
+{
+	struct stat st;
+
+	printf("%s: %s: %s\n", self, file, type);
+
+	if (!strcmp(type, "relocatable")) {
+		run_cmd(strip_kmod_cmd, file);
+		return;
+	}
+
+	if (stat(file, &st) < 0)
+		return;
+
+	if (fix_rpath) {
+		if (!(st.st_mode & S_IWUSR))
+			chmod(file, st.st_mode | S_IWUSR);
+		fixup_rpath(file);
+	}
+
+	run_cmd(strip_cmd, file);
+	chmod(file, st.st_mode & 07777);
+}
+
+static void alarm_handler(int sig)
+{
+}
+
+static bool fd_valid(int fd)
+{
+	return fd >= 0 && fcntl(fd, F_GETFD) >= 0;
+}
+
+static void jobserver_init(void)
+{
+	const char *flags = getenv("MAKEFLAGS");
+	const char *js = getenv("MAKE_JOBSERVER");
+	const char *arg = NULL;
+	struct sigaction sa = {
+		.sa_handler = alarm_handler,
+	};
+	char *fifo;
+
+	if (js && *js)
+		arg = js;
+	else if (flags)
+		arg = flags;
+
+	if (!arg)
+		return;
+
+	if ((fifo = strstr(arg, "--jobserver-auth=fifo:")) != NULL) {
+		char *path = strdup(fifo + strlen("--jobserver-auth=fifo:"));
+
+		if (!path)
+			return;
+		path[strcspn(path, " ")] = 0;
+		js_rfd = js_wfd = open(path, O_RDWR);
+		free(path);
+	} else if ((fifo = strstr(arg, "--jobserver-auth=")) != NULL) {
+		sscanf(fifo + strlen("--jobserver-auth="), "%d,%d", &js_rfd, &js_wfd);
+	} else if ((fifo = strstr(arg, "--jobserver-fds=")) != NULL) {
+		sscanf(fifo + strlen("--jobserver-fds="), "%d,%d", &js_rfd, &js_wfd);
+	}
+
+	if (!fd_valid(js_rfd) || !fd_valid(js_wfd)) {
+		js_rfd = js_wfd = -1;
+		return;
+	}
+
+	sigaction(SIGALRM, &sa, NULL);
+}
+
+static void release_job(void)
+{
+	running--;
+	if (js_held) {
+		js_held--;
+		if (write(js_wfd, &js_tokens[js_held], 1) != 1)
+			perror("jobserver");
+	}
+}
+
+static void reap(bool block)
+{
+	int status;
+
+	while (running > 0 && waitpid(-1, &status, block ? 0 : WNOHANG) > 0) {
+		release_job();
+		block = false;
+	}
+}
+
+static void acquire_job(void)
+{
+	struct itimerval it = {
+		.it_value.tv_usec = 100 * 1000,
+	};
+	struct itimerval off = {};
+	char token;
+
+	if (js_rfd < 0) {
+		while (running >= max_jobs)
+			reap(true);
+		return;
+	}
+
+	/* the first job always runs in our own slot */
+	while (running > 0) {
+		ssize_t len;
+
+		reap(false);
+		if (!running)
+			break;
+
+		setitimer(ITIMER_REAL, &it, NULL);
+		len = read(js_rfd, &token, 1);
+		setitimer(ITIMER_REAL, &off, NULL);
+
+		if (len == 1) {
+			js_tokens = realloc(js_tokens, js_held + 1);
+			js_tokens[js_held++] = token;
+			break;
+		}
+	}
+}
+
+static int visit(const char *path, const struct stat *st, int flag,
+		 struct FTW *ftw)
+{
+	uint8_t hdr[EI_NIDENT + 2];
+	const char *type;
+	ssize_t len;
+	pid_t pid;
+	int fd;
+
+	if (flag != FTW_F || !S_ISREG(st->st_mode))
+		return 0;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	len = read(fd, hdr, sizeof(hdr));
+	close(fd);
+
+	type = elf_type(hdr, len > 0 ? len : 0);
+	if (!type)
+		return 0;
+
+	acquire_job();
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		process_file(path, type);
+		release_job();
+		return 0;
+	}
+
+	if (pid == 0) {
+		process_file(path, type);
+		fflush(stdout);
+		_exit(0);
+	}
+
+	running++;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ch, i;
+
+	while ((ch = getopt(argc, argv, "j:")) != -1) {
+		switch (ch) {
+		case 'j':
+			max_jobs = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	strip_cmd = getenv("STRIP");
+	strip_kmod_cmd = getenv("STRIP_KMOD");
+	if (!strip_cmd || !*strip_cmd) {
+		printf("%s: strip command not defined (STRIP variable not set)\n", self);
+		return 1;
+	}
+
+	if (!argc)
+		goto usage;
+
+	if (!strip_kmod_cmd || !*strip_kmod_cmd)
+		strip_kmod_cmd = ":";
+
+	fix_rpath = getenv("PATCHELF") && *getenv("PATCHELF") &&
+		    getenv("TOPDIR") && *getenv("TOPDIR");
+
+	if (max_jobs < 1)
+		max_jobs = 1;
+	if (max_jobs == 1)
+		jobserver_init();
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	for (i = 0; i < argc; i++)
+		nftw(argv[i], visit, 16, FTW_PHYS);
+
+	while (running > 0)
+		reap(true);
+
+	return 0;
+
+usage:
+	printf("%s: no directories / files specified\n", self);
+	printf("usage: %s [-j <jobs>] [PATH...]\n", self);
+	return 1;
+}
@@ -22,6 +22,41 @@ if [ -z "$KEEP_BUILD_ID" ]; then
     ARGS="$ARGS -R .note.gnu.build-id"
 fi
 
+# stripped modules are cached by their input and the strip options, so
+# unchanged modules are not processed again after a kernel rebuild. Only
+# the STRIP_KMOD_CACHE_ENTRIES most recently used results are kept.
+CACHE=
+CACHE_ENTRIES="${STRIP_KMOD_CACHE_ENTRIES:-2048}"
+if [ -n "$STRIP_KMOD_CACHE" ] && [ -x "$MKHASH" ]; then
+	CACHE="$STRIP_KMOD_CACHE/$( {
+		echo "$CROSS $ARGS $NO_RENAME"
+		cat "$MODULE"
+	} | "$MKHASH" md5 ).ko"
+	cp "$CACHE" "$MODULE" 2>/dev/null && {
+		touch -c "$CACHE"
+		exit 0
+	}
+fi
+
+evict_cache() {
+	ls -t "$STRIP_KMOD_CACHE"/*.ko 2>/dev/null | \
+		tail -n +$((CACHE_ENTRIES + 1)) | xargs -r rm -f
+}
+
+store_cache() {
+	[ -n "$CACHE" ] || return 0
+	mkdir -p "$STRIP_KMOD_CACHE"
+	cp "$MODULE" "$CACHE.$$" && mv "$CACHE.$$" "$CACHE"
+	if command -v flock >/dev/null; then
+		(
+			flock 9
+			evict_cache
+		) 9> "$STRIP_KMOD_CACHE/.lock"
+	else
+		evict_cache
+	fi
+}
+
 ${CROSS}objcopy \
 	-R .comment \
 	-R .pdr \
@@ -35,6 +70,7 @@ ${CROSS}objcopy \
 
 [ -n "$NO_RENAME" ] && {
 	mv "${MODULE}.tmp" "$MODULE"
+	store_cache
 	exit 0
 }
 
@@ -50,6 +86,7 @@ $3 && $2 ~ /[brtd]/ && $3 !~ /\$LC/ && !def[$3] {
 }
 ' > "$MODULE.tmp1"
 
-${CROSS}objcopy `cat ${MODULE}.tmp1` ${MODULE}.tmp ${MODULE}.out
+${CROSS}objcopy @"${MODULE}.tmp1" ${MODULE}.tmp ${MODULE}.out
 mv "${MODULE}.out" "${MODULE}"
 rm -f "${MODULE}".t*
+store_cache
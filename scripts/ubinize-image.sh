@@ -74,6 +74,25 @@ ubilayout() {
 	[ "$root_is_ubifs" ] || ubivol $vol_id rootfs_data "" 1
 }
 
+# identical layouts built from identical payloads give the same image,
+# hash the ubinize binary, the options, the layout and every volume
+# image. Image paths are per device, so they are left out of the layout
+# and only the contents of the images go into the key.
+ubinize_cache_key() {
+	{
+		mkhash md5 "$ubinize"
+		echo "$ubinize_param"
+		sed -e 's/^image=.*/image=/' "$1"
+		mkhash md5 $( sed -ne 's/^image=//p' "$1" )
+	} | mkhash md5
+}
+
+# keep the UBINIZE_CACHE_ENTRIES most recently used images
+ubinize_cache_evict() {
+	ls -t "$UBINIZE_CACHE_DIR"/*.ubi 2>/dev/null | \
+		tail -n +$(( ${UBINIZE_CACHE_ENTRIES:-16} + 1 )) | xargs -r rm -f
+}
+
 while [ "$1" ]; do
 	case "$1" in
 	"--uboot-env")
@@ -131,9 +150,35 @@ fi
 ubilayout "$ubootenv" "$rootfs" "$kernel" > "$ubinizecfg"
 
 cat "$ubinizecfg"
-ubinize -o "$outfile" $ubinize_param "$ubinizecfg"
-err="$?"
-[ ! -e "$outfile" ] && err=2
+
+cachefile=""
+if [ -n "$UBINIZE_CACHE_DIR" ] && [ -x "$( which mkhash )" ]; then
+	mkdir -p "$UBINIZE_CACHE_DIR"
+	cachefile="$UBINIZE_CACHE_DIR/$( ubinize_cache_key "$ubinizecfg" ).ubi"
+fi
+
+if [ -n "$cachefile" ] && cp "$cachefile" "$outfile" 2>/dev/null; then
+	echo "using cached $cachefile"
+	touch -c "$cachefile"
+	err=0
+else
+	ubinize -o "$outfile" $ubinize_param "$ubinizecfg"
+	err="$?"
+	[ ! -e "$outfile" ] && err=2
+	[ "$err" = 0 ] && [ -n "$cachefile" ] && \
+		cp "$outfile" "$cachefile.$$" && mv "$cachefile.$$" "$cachefile"
+fi
 rm "$ubinizecfg"
 
+if [ -n "$cachefile" ]; then
+	if [ -x "$( which flock )" ]; then
+		(
+			flock 9
+			ubinize_cache_evict
+		) 9> "$UBINIZE_CACHE_DIR/.lock"
+	else
+		ubinize_cache_evict
+	fi
+fi
+
 exit $err
@@ -19,11 +19,150 @@
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
 #include <linux/byteorder/generic.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 
 #include "mtdsplit.h"
 
 #define UBI_EC_MAGIC			0x55424923	/* UBI# */
 
+/*
+ * Every firmware parser starts by reading its header from the beginning of
+ * the partition, and several of them are tried in turn on the same one.
+ * While one parse pass runs, keep the first few hundred bytes of the
+ * partition around, so that these header and superblock reads cost one
+ * flash access instead of one per parser. The cache is freed again as soon
+ * as the pass is over.
+ */
+#define MTDSPLIT_CACHE_SIZE		512
+
+struct mtdsplit_cache {
+	struct list_head list;
+	struct mtd_info *mtd;
+	bool valid;
+	unsigned int hits;
+	unsigned int misses;
+	u_char buf[MTDSPLIT_CACHE_SIZE];
+};
+
+static LIST_HEAD(mtdsplit_caches);
+static DEFINE_MUTEX(mtdsplit_cache_lock);
+
+static struct mtdsplit_cache *mtdsplit_cache_find(struct mtd_info *mtd)
+{
+	struct mtdsplit_cache *cache;
+
+	list_for_each_entry(cache, &mtdsplit_caches, list)
+		if (cache->mtd == mtd)
+			return cache;
+
+	return NULL;
+}
+
+void mtdsplit_cache_begin(struct mtd_info *mtd)
+{
+	struct mtdsplit_cache *cache;
+
+	if (mtd->size < MTDSPLIT_CACHE_SIZE)
+		return;
+
+	/* without a cache, every read simply goes to the flash */
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return;
+
+	cache->mtd = mtd;
+
+	mutex_lock(&mtdsplit_cache_lock);
+	if (mtdsplit_cache_find(mtd)) {
+		mutex_unlock(&mtdsplit_cache_lock);
+		kfree(cache);
+		return;
+	}
+	list_add(&cache->list, &mtdsplit_caches);
+	mutex_unlock(&mtdsplit_cache_lock);
+}
+EXPORT_SYMBOL_GPL(mtdsplit_cache_begin);
+
+void mtdsplit_cache_end(struct mtd_info *mtd)
+{
+	struct mtdsplit_cache *cache;
+
+	mutex_lock(&mtdsplit_cache_lock);
+	cache = mtdsplit_cache_find(mtd);
+	if (cache)
+		list_del(&cache->list);
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	if (!cache)
+		return;
+
+	pr_debug("header cache of \"%s\": %u hits, %u misses\n",
+		 mtd->name, cache->hits, cache->misses);
+
+	kfree(cache);
+}
+EXPORT_SYMBOL_GPL(mtdsplit_cache_end);
+
+static int mtdsplit_read_flash(struct mtd_info *mtd, loff_t from, size_t len,
+			       size_t *retlen, u_char *buf)
+{
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = mtd_read(mtd, from, len, retlen, buf);
+
+	pr_debug("read %zu bytes at 0x%llx from \"%s\" in %lld us\n",
+		 len, (unsigned long long) from, mtd->name,
+		 ktime_us_delta(ktime_get(), start));
+
+	return ret;
+}
+
+int mtdsplit_read(struct mtd_info *mtd, loff_t from, size_t len,
+		  size_t *retlen, u_char *buf)
+{
+	struct mtdsplit_cache *cache;
+	size_t cache_len;
+	int ret;
+
+	if (from < 0 || from + len > MTDSPLIT_CACHE_SIZE)
+		return mtdsplit_read_flash(mtd, from, len, retlen, buf);
+
+	/*
+	 * Only the pass that created the cache reads through it, and that
+	 * pass also frees it, so it stays valid without holding the lock.
+	 */
+	mutex_lock(&mtdsplit_cache_lock);
+	cache = mtdsplit_cache_find(mtd);
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	if (!cache)
+		return mtdsplit_read_flash(mtd, from, len, retlen, buf);
+
+	if (!cache->valid) {
+		cache->misses++;
+
+		ret = mtdsplit_read_flash(mtd, 0, MTDSPLIT_CACHE_SIZE,
+					  &cache_len, cache->buf);
+		if (ret || cache_len != MTDSPLIT_CACHE_SIZE)
+			return mtdsplit_read_flash(mtd, from, len, retlen, buf);
+
+		cache->valid = true;
+	} else {
+		cache->hits++;
+	}
+
+	memcpy(buf, cache->buf + from, len);
+	*retlen = len;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mtdsplit_read);
+
 struct squashfs_super_block {
 	__le32 s_magic;
 	__le32 pad0[9];
@@ -38,7 +177,7 @@ int mtd_get_squashfs_len(struct mtd_info *master,
 	size_t retlen;
 	int err;
 
-	err = mtd_read(master, offset, sizeof(sb), &retlen, (void *)&sb);
+	err = mtdsplit_read(master, offset, sizeof(sb), &retlen, (void *)&sb);
 	if (err || (retlen != sizeof(sb))) {
 		pr_alert("error occured while reading from \"%s\"\n",
 			 master->name);
@@ -79,8 +218,8 @@ int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 	size_t retlen;
 	int ret;
 
-	ret = mtd_read(mtd, offset, sizeof(magic), &retlen,
-		       (unsigned char *) &magic);
+	ret = mtdsplit_read(mtd, offset, sizeof(magic), &retlen,
+			    (unsigned char *) &magic);
 	if (ret)
 		return ret;
 
@@ -111,20 +250,26 @@ int mtd_find_rootfs_from(struct mtd_info *mtd,
 			 size_t *ret_offset,
 			 enum mtdsplit_part_type *type)
 {
+	ktime_t start = ktime_get();
+	unsigned int probes = 0;
 	size_t offset;
-	int err;
+	int err = -ENODEV;
 
 	for (offset = from; offset < limit;
 	     offset = mtd_next_eb(mtd, offset)) {
-		err = mtd_check_rootfs_magic(mtd, offset, type);
-		if (err)
+		probes++;
+		if (mtd_check_rootfs_magic(mtd, offset, type))
 			continue;
 
 		*ret_offset = offset;
-		return 0;
+		err = 0;
+		break;
 	}
 
-	return -ENODEV;
+	pr_debug("probed %u blocks of \"%s\" for a rootfs in %lld us\n",
+		 probes, mtd->name, ktime_us_delta(ktime_get(), start));
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(mtd_find_rootfs_from);
 
@@ -27,6 +27,12 @@ enum mtdsplit_part_type {
 };
 
 #ifdef CONFIG_MTD_SPLIT
+void mtdsplit_cache_begin(struct mtd_info *mtd);
+void mtdsplit_cache_end(struct mtd_info *mtd);
+
+int mtdsplit_read(struct mtd_info *mtd, loff_t from, size_t len,
+		  size_t *retlen, u_char *buf);
+
 int mtd_get_squashfs_len(struct mtd_info *master,
 			 size_t offset,
 			 size_t *squashfs_len);
@@ -41,6 +47,20 @@ int mtd_find_rootfs_from(struct mtd_info *mtd,
 			 enum mtdsplit_part_type *type);
 
 #else
+static inline void mtdsplit_cache_begin(struct mtd_info *mtd)
+{
+}
+
+static inline void mtdsplit_cache_end(struct mtd_info *mtd)
+{
+}
+
+static inline int mtdsplit_read(struct mtd_info *mtd, loff_t from, size_t len,
+				size_t *retlen, u_char *buf)
+{
+	return mtd_read(mtd, from, len, retlen, buf);
+}
+
 static inline int mtd_get_squashfs_len(struct mtd_info *master,
 				       size_t offset,
 				       size_t *squashfs_len)
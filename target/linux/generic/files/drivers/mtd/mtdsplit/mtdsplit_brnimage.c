@@ -49,8 +49,8 @@ static int mtdsplit_parse_brnimage(struct mtd_info *master,
 	if (rootfs_offset >= master->size)
 		return -EINVAL;
 
-	ret = mtd_read(master, rootfs_offset - BRNIMAGE_FOOTER_SIZE, 4, &len,
-			(void *)&buf);
+	ret = mtdsplit_read(master, rootfs_offset - BRNIMAGE_FOOTER_SIZE, 4,
+			    &len, (void *)&buf);
 	if (ret)
 		return ret;
 
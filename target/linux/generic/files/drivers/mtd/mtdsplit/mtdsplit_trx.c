@@ -39,8 +39,8 @@ read_trx_header(struct mtd_info *mtd, size_t offset,
 	int ret;
 
 	header_len = sizeof(*header);
-	ret = mtd_read(mtd, offset, header_len, &retlen,
-		       (unsigned char *) header);
+	ret = mtdsplit_read(mtd, offset, header_len, &retlen,
+			    (unsigned char *) header);
 	if (ret) {
 		pr_debug("read error in \"%s\"\n", mtd->name);
 		return ret;
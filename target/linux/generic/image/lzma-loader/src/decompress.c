@@ -78,31 +78,32 @@ static __inline__ void blast_dcache(unsigned long size, unsigned long lsize)
 	}
 }
 
+/* This puts lzma workspace 128k below RAM end. 
+ * That should be enough for both lzma and stack
+ */
+static char *buffer = (char *)(RAMSTART + RAMSIZE - 0x00020000);
+extern unsigned char lzma_start[];
+extern unsigned char lzma_end[];
+
 unsigned char *data;
 
-static int read_byte(void *object, unsigned char **buffer, UInt32 *bufferSize)
+/*
+ * The whole stream is linked into the image, so hand the rest of it to
+ * the decoder in one go instead of refilling its buffer for every byte.
+ */
+static int read_data(void *object, const unsigned char **buffer, SizeT *bufferSize)
 {
-	*bufferSize = 1;
+	*bufferSize = lzma_end - data;
 	*buffer = data;
-	++data;
+	data = lzma_end;
 	return LZMA_RESULT_OK;
 }
 
 static __inline__ unsigned char get_byte(void)
 {
-	unsigned char *buffer;
-	UInt32 fake;
-	
-	return read_byte(0, &buffer, &fake), *buffer;
+	return *data++;
 }
 
-/* This puts lzma workspace 128k below RAM end. 
- * That should be enough for both lzma and stack
- */
-static char *buffer = (char *)(RAMSTART + RAMSIZE - 0x00020000);
-extern char lzma_start[];
-extern char lzma_end[];
-
 /* should be the first function */
 void entry(unsigned long icache_size, unsigned long icache_lsize, 
 	unsigned long dcache_size, unsigned long dcache_lsize)
@@ -119,7 +120,7 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 
 	ILzmaInCallback callback;
 	CLzmaDecoderState vs;
-	callback.Read = read_byte;
+	callback.Read = read_data;
 
 	data = lzma_start;
 
@@ -0,0 +1,223 @@
+/*
+ * Minimal stand-ins for the kernel interfaces used by the mtdsplit parsers,
+ * so that their unmodified sources can be built and run on the host.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ */
+
+#ifndef _KERNEL_SHIM_H
+#define _KERNEL_SHIM_H
+
+#define _GNU_SOURCE
+
+#include <endian.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define CONFIG_MTD_SPLIT	1
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef uint16_t __be16;
+typedef uint32_t __be32;
+typedef uint16_t __le16;
+typedef uint32_t __le32;
+typedef uint64_t __le64;
+
+#define __init
+#define THIS_MODULE		NULL
+#define EXPORT_SYMBOL_GPL(sym)
+
+#define module_init(fn) \
+	static void __attribute__((constructor)) fn##_ctor(void) { fn(); }
+#define subsys_initcall(fn)	module_init(fn)
+
+extern int mtdsplit_test_verbose;
+
+/* pr_fmt() is not defined by every parser, so prefix the module name here */
+#define pr_debug(fmt, ...) \
+	do { \
+		if (mtdsplit_test_verbose) \
+			fprintf(stderr, KBUILD_MODNAME ": " fmt, \
+				##__VA_ARGS__); \
+	} while (0)
+#define pr_info(fmt, ...)	pr_debug(fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)	pr_debug(fmt, ##__VA_ARGS__)
+#define pr_alert(fmt, ...)	pr_debug(fmt, ##__VA_ARGS__)
+
+#define be16_to_cpu(x)		be16toh(x)
+#define be32_to_cpu(x)		be32toh(x)
+#define le32_to_cpu(x)		le32toh(x)
+#define le64_to_cpu(x)		le64toh(x)
+#define cpu_to_be32(x)		htobe32(x)
+#define cpu_to_le32(x)		htole32(x)
+
+static inline u32 get_unaligned_le32(const void *p)
+{
+	u32 v;
+
+	memcpy(&v, p, sizeof(v));
+	return le32toh(v);
+}
+
+static inline bool is_power_of_2(unsigned long n)
+{
+	return n != 0 && (n & (n - 1)) == 0;
+}
+
+#define round_up(x, y)		((((x) - 1) | ((__typeof__(x))((y) - 1))) + 1)
+
+#define GFP_KERNEL		0
+#define kzalloc(size, flags)	calloc(1, size)
+#define kfree(p)		free((void *) (p))
+#define vmalloc(size)		malloc(size)
+#define vfree(p)		free(p)
+
+#define SQUASHFS_MAGIC		0x73717368
+#define OF_DT_HEADER		0xd00dfeed
+
+/* lists */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD(name) \
+	struct list_head name = { &(name), &(name) }
+
+#define container_of(ptr, type, member) \
+	((type *) ((char *) (ptr) - offsetof(type, member)))
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_entry((head)->next, __typeof__(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_entry(pos->member.next, __typeof__(*pos), member))
+
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+	entry->next = head->next;
+	entry->prev = head;
+	head->next->prev = entry;
+	head->next = entry;
+}
+
+static inline void list_add_tail(struct list_head *entry,
+				 struct list_head *head)
+{
+	list_add(entry, head->prev);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	entry->next = entry->prev = NULL;
+}
+
+/* the parsers run single threaded here */
+struct mutex {
+	int unused;
+};
+
+#define DEFINE_MUTEX(name)	struct mutex name
+#define mutex_lock(lock)	do { (void) (lock); } while (0)
+#define mutex_unlock(lock)	do { (void) (lock); } while (0)
+
+typedef int64_t ktime_t;
+
+static inline ktime_t ktime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ktime_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline long long ktime_us_delta(ktime_t later, ktime_t earlier)
+{
+	return (later - earlier) / 1000;
+}
+
+/* mtd */
+struct mtd_info {
+	const char *name;
+	uint64_t size;
+	uint32_t erasesize;
+
+	/* the flash contents and the partition this device is part of */
+	const u_char *data;
+	struct mtd_info *parent;
+	uint64_t offset;
+
+	/* flash accesses made through mtd_read() */
+	unsigned int reads;
+};
+
+struct mtd_partition {
+	const char *name;
+	uint64_t size;
+	uint64_t offset;
+	uint32_t mask_flags;
+};
+
+struct mtd_part_parser_data {
+	unsigned long origin;
+};
+
+enum mtd_parser_type {
+	MTD_PARSER_TYPE_DEVICE = 0,
+	MTD_PARSER_TYPE_ROOTFS,
+	MTD_PARSER_TYPE_FIRMWARE,
+};
+
+struct mtd_part_parser {
+	struct list_head list;
+	void *owner;
+	const char *name;
+	int (*parse_fn)(struct mtd_info *, const struct mtd_partition **,
+			struct mtd_part_parser_data *);
+	void (*cleanup)(const struct mtd_partition *pparts, int nr_parts);
+	enum mtd_parser_type type;
+};
+
+int mtd_read(struct mtd_info *mtd, loff_t from, size_t len, size_t *retlen,
+	     u_char *buf);
+void register_mtd_parser(struct mtd_part_parser *parser);
+
+static inline struct mtd_info *mtdpart_get_master(const struct mtd_info *mtd)
+{
+	return mtd->parent ? mtd->parent : (struct mtd_info *) mtd;
+}
+
+static inline uint64_t mtdpart_get_offset(const struct mtd_info *mtd)
+{
+	return mtd->parent ? mtd->offset : 0;
+}
+
+static inline uint64_t mtd_roundup_to_eb(uint64_t sz, struct mtd_info *mtd)
+{
+	if (sz % mtd->erasesize == 0)
+		return sz;
+
+	return (sz / mtd->erasesize + 1) * mtd->erasesize;
+}
+
+static inline uint64_t mtd_rounddown_to_eb(uint64_t sz, struct mtd_info *mtd)
+{
+	return sz / mtd->erasesize * mtd->erasesize;
+}
+
+#endif /* _KERNEL_SHIM_H */
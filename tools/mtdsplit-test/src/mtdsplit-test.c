@@ -0,0 +1,539 @@
+/*
+ * Host test harness for the mtdsplit firmware and rootfs parsers
+ *
+ * The parser sources from target/linux/generic/files/drivers/mtd/mtdsplit
+ * are built unmodified against kernel-shim.h. Without an image argument the
+ * built-in fixtures are checked, otherwise every parser of the requested
+ * type is run over the given image the same way the kernel does it.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ */
+
+#include <unistd.h>
+
+#include "mtdsplit.h"
+
+#define ERASESIZE	0x10000
+#define FLASHSIZE	0x400000
+
+int mtdsplit_test_verbose;
+
+static LIST_HEAD(parsers);
+static int failures;
+
+void register_mtd_parser(struct mtd_part_parser *parser)
+{
+	list_add_tail(&parser->list, &parsers);
+}
+
+int mtd_read(struct mtd_info *mtd, loff_t from, size_t len, size_t *retlen,
+	     u_char *buf)
+{
+	mtd->reads++;
+
+	if (from < 0 || from > mtd->size)
+		return -EINVAL;
+
+	if (len > mtd->size - from)
+		len = mtd->size - from;
+
+	memcpy(buf, mtd->data + from, len);
+	*retlen = len;
+
+	return 0;
+}
+
+static struct mtd_part_parser *find_parser(const char *name)
+{
+	struct mtd_part_parser *parser;
+
+	list_for_each_entry(parser, &parsers, list)
+		if (!strcmp(parser->name, name))
+			return parser;
+
+	return NULL;
+}
+
+/* like parse_mtd_partitions_by_type(), with the header cache around it */
+static int run_parsers(struct mtd_info *mtd, enum mtd_parser_type type,
+		       const struct mtd_partition **pparts,
+		       const char **name)
+{
+	struct mtd_part_parser *parser;
+	int ret = 0;
+
+	mtdsplit_cache_begin(mtd);
+
+	list_for_each_entry(parser, &parsers, list) {
+		if (parser->type != type)
+			continue;
+
+		ret = parser->parse_fn(mtd, pparts, NULL);
+		if (ret > 0) {
+			*name = parser->name;
+			break;
+		}
+	}
+
+	mtdsplit_cache_end(mtd);
+
+	return ret;
+}
+
+/*
+ * fixtures
+ */
+
+static void put_be16(u_char *p, uint16_t v)
+{
+	v = htobe16(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static void put_be32(u_char *p, uint32_t v)
+{
+	v = htobe32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static void put_le32(u_char *p, uint32_t v)
+{
+	v = htole32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static void put_squashfs(u_char *p, uint64_t bytes_used)
+{
+	put_le32(p, SQUASHFS_MAGIC);
+	bytes_used = htole64(bytes_used);
+	memcpy(p + 40, &bytes_used, sizeof(bytes_used));
+}
+
+static void put_uimage(u_char *p, uint32_t magic, uint8_t type, uint32_t size)
+{
+	put_be32(p, magic);
+	put_be32(p + 12, size);
+	p[28] = 5;		/* ih_os: Linux */
+	p[30] = type;		/* ih_type */
+}
+
+static void fixture_trx(u_char *img)
+{
+	put_le32(img, 0x30524448);
+	put_le32(img + 4, FLASHSIZE);
+	put_le32(img + 16, 0x1c);
+	put_le32(img + 20, 0x100000);
+}
+
+static void fixture_uimage(u_char *img)
+{
+	put_uimage(img, 0x27051956, 2, 0x20000);
+	put_squashfs(img + 0x30000, 0x100000);
+}
+
+static void fixture_uimage_ubi(u_char *img)
+{
+	put_uimage(img, 0x27051956, 2, 0x20000);
+	put_be32(img + 0x30000, 0x55424923);
+}
+
+static void fixture_uimage_netgear(u_char *img)
+{
+	put_uimage(img, 0x33373030, 7, 0x40000);
+	put_squashfs(img + 0x50000, 0x100000);
+}
+
+static void fixture_uimage_edimax(u_char *img)
+{
+	put_be32(img, 0x43535953);
+	put_uimage(img + 20, 0x27051956, 2, 0x40000);
+	put_squashfs(img + 0x50000, 0x100000);
+}
+
+static void fixture_lzma(u_char *img)
+{
+	img[0] = 0x5d;
+	put_le32(img + 1, 0x800000);
+	put_le32(img + 5, 0x300000);
+	put_le32(img + 9, 0);
+	put_squashfs(img + 0x20000, 0x100000);
+}
+
+static void fixture_seama(u_char *img)
+{
+	put_be32(img, 0x5ea3a417);
+	put_be16(img + 6, 0x10);
+	put_be32(img + 8, 0x1000);
+	put_squashfs(img + 28 + 0x10 + 0x1000, 0x100000);
+}
+
+static void fixture_tplink(u_char *img)
+{
+	put_le32(img, 1);
+	put_be32(img + 4 + 0x7c, 0x200);	/* kernel_ofs */
+	put_be32(img + 4 + 0x80, 0x10000);	/* kernel_len */
+	put_be32(img + 4 + 0x84, 0x20000);	/* rootfs_ofs */
+	put_squashfs(img + 0x20000, 0x100000);
+}
+
+static void fixture_brnimage(u_char *img)
+{
+	put_le32(img + 0x20000 - 12, 0x1fd00);
+	put_squashfs(img + 0x20000, 0x100000);
+}
+
+static void fixture_squashfs_split(u_char *img)
+{
+	put_squashfs(img, 0x12345);
+}
+
+static const struct fixture {
+	const char *name;
+	void (*fill)(u_char *img);
+	enum mtd_parser_type type;
+	const char *parser;
+	struct mtd_partition parts[2];
+} fixtures[] = {
+	{
+		"trx", fixture_trx, MTD_PARSER_TYPE_FIRMWARE, "trx-fw", {
+			{ "kernel", 0x100000 - 0x1c, 0x1c },
+			{ "rootfs", FLASHSIZE - 0x100000, 0x100000 },
+		}
+	}, {
+		"uimage", fixture_uimage, MTD_PARSER_TYPE_FIRMWARE,
+		"uimage-fw", {
+			{ "kernel", 0x30000, 0 },
+			{ "rootfs", FLASHSIZE - 0x30000, 0x30000 },
+		}
+	}, {
+		"uimage-ubi", fixture_uimage_ubi, MTD_PARSER_TYPE_FIRMWARE,
+		"uimage-fw", {
+			{ "kernel", 0x30000, 0 },
+			{ "ubi", FLASHSIZE - 0x30000, 0x30000 },
+		}
+	}, {
+		"netgear", fixture_uimage_netgear, MTD_PARSER_TYPE_FIRMWARE,
+		"netgear-fw", {
+			{ "kernel", 0x50000, 0 },
+			{ "rootfs", FLASHSIZE - 0x50000, 0x50000 },
+		}
+	}, {
+		"edimax", fixture_uimage_edimax, MTD_PARSER_TYPE_FIRMWARE,
+		"edimax-fw", {
+			{ "kernel", 0x50000, 0 },
+			{ "rootfs", FLASHSIZE - 0x50000, 0x50000 },
+		}
+	}, {
+		"lzma", fixture_lzma, MTD_PARSER_TYPE_FIRMWARE, "lzma-fw", {
+			{ "kernel", 0x20000, 0 },
+			{ "rootfs", FLASHSIZE - 0x20000, 0x20000 },
+		}
+	}, {
+		"seama", fixture_seama, MTD_PARSER_TYPE_FIRMWARE, "seama-fw", {
+			{ "kernel", 0x1000, 28 + 0x10 },
+			{ "rootfs", FLASHSIZE - 0x102c, 0x102c },
+		}
+	}, {
+		"tplink", fixture_tplink, MTD_PARSER_TYPE_FIRMWARE,
+		"tplink-fw", {
+			{ "kernel", 0x10200, 0 },
+			{ "rootfs", FLASHSIZE - 0x20000, 0x20000 },
+		}
+	}, {
+		"brnimage", fixture_brnimage, MTD_PARSER_TYPE_FIRMWARE,
+		"brnimage-fw", {
+			{ "kernel", 0x1fd00, 0 },
+			{ "rootfs", FLASHSIZE - 0x20000 - 12, 0x20000 },
+		}
+	}, {
+		"squashfs-split", fixture_squashfs_split,
+		MTD_PARSER_TYPE_ROOTFS, "squashfs-split", {
+			{ "rootfs_data", FLASHSIZE - 0x20000, 0x20000 },
+		}
+	},
+};
+
+#define fail(...) \
+	do { \
+		fprintf(stderr, "FAIL: " __VA_ARGS__); \
+		failures++; \
+	} while (0)
+
+static void check_parts(const char *what, const struct mtd_partition *parts,
+			int nr_parts, const struct mtd_partition *expect)
+{
+	int i;
+
+	for (i = 0; i < nr_parts; i++) {
+		if (!strcmp(parts[i].name, expect[i].name) &&
+		    parts[i].offset == expect[i].offset &&
+		    parts[i].size == expect[i].size)
+			continue;
+
+		fail("%s: partition %d is %s@0x%llx+0x%llx, expected %s@0x%llx+0x%llx\n",
+		     what, i, parts[i].name,
+		     (unsigned long long) parts[i].offset,
+		     (unsigned long long) parts[i].size, expect[i].name,
+		     (unsigned long long) expect[i].offset,
+		     (unsigned long long) expect[i].size);
+	}
+}
+
+static void check_fixture(const struct fixture *f, u_char *img)
+{
+	struct mtd_info mtd = {
+		.name = f->name,
+		.size = FLASHSIZE,
+		.erasesize = ERASESIZE,
+		.data = img,
+	};
+	const struct mtd_partition *parts = NULL;
+	struct mtd_part_parser *parser;
+	int expect_parts = f->parts[1].name ? 2 : 1;
+	int ret;
+
+	memset(img, 0xff, FLASHSIZE);
+	f->fill(img);
+
+	parser = find_parser(f->parser);
+	if (!parser) {
+		fail("%s: parser %s not registered\n", f->name, f->parser);
+		return;
+	}
+
+	mtdsplit_cache_begin(&mtd);
+	ret = parser->parse_fn(&mtd, &parts, NULL);
+	mtdsplit_cache_end(&mtd);
+
+	if (ret != expect_parts) {
+		fail("%s: %s returned %d, expected %d\n", f->name, f->parser,
+		     ret, expect_parts);
+		if (ret > 0)
+			kfree(parts);
+		return;
+	}
+
+	check_parts(f->name, parts, ret, f->parts);
+	kfree(parts);
+}
+
+/* an erased flash must not be taken for a firmware image */
+static void check_blank(u_char *img)
+{
+	struct mtd_info mtd = {
+		.name = "blank",
+		.size = FLASHSIZE,
+		.erasesize = ERASESIZE,
+		.data = img,
+	};
+	struct mtd_part_parser *parser;
+	const struct mtd_partition *parts;
+	int ret;
+
+	memset(img, 0xff, FLASHSIZE);
+
+	list_for_each_entry(parser, &parsers, list) {
+		ret = parser->parse_fn(&mtd, &parts, NULL);
+		if (ret <= 0)
+			continue;
+
+		fail("blank: %s found %d partitions\n", parser->name, ret);
+		kfree(parts);
+	}
+}
+
+/*
+ * One pass over all firmware parsers must read the partition header from
+ * flash once, and the cache must be gone once the pass is over.
+ */
+static void check_cache(u_char *img)
+{
+	struct mtd_info mtd = {
+		.name = "cache",
+		.size = FLASHSIZE,
+		.erasesize = ERASESIZE,
+		.data = img,
+	};
+	const struct mtd_partition *parts;
+	const char *name = NULL;
+	unsigned int cached, uncached = 0;
+	struct mtd_part_parser *parser;
+	u_char buf[16];
+	size_t retlen;
+	int ret;
+
+	memset(img, 0xff, FLASHSIZE);
+	fixture_trx(img);
+
+	list_for_each_entry(parser, &parsers, list) {
+		if (parser->type != MTD_PARSER_TYPE_FIRMWARE)
+			continue;
+
+		mtd.reads = 0;
+		ret = parser->parse_fn(&mtd, &parts, NULL);
+		uncached += mtd.reads;
+		if (ret > 0) {
+			kfree(parts);
+			break;
+		}
+	}
+
+	mtd.reads = 0;
+	ret = run_parsers(&mtd, MTD_PARSER_TYPE_FIRMWARE, &parts, &name);
+	cached = mtd.reads;
+	if (ret > 0)
+		kfree(parts);
+
+	if (ret != 2 || strcmp(name, "trx-fw"))
+		fail("cache: pass found %d partitions with %s\n", ret, name);
+
+	if (cached >= uncached)
+		fail("cache: %u flash reads with the cache, %u without\n",
+		     cached, uncached);
+
+	mtd.reads = 0;
+	mtdsplit_read(&mtd, 0, sizeof(buf), &retlen, buf);
+	if (mtd.reads != 1)
+		fail("cache: read after the pass did not go to flash\n");
+
+	if (mtdsplit_test_verbose)
+		fprintf(stderr, "cache: %u flash reads with the cache, %u without\n",
+			cached, uncached);
+}
+
+static int self_test(void)
+{
+	u_char *img;
+	int i;
+
+	img = malloc(FLASHSIZE);
+	if (!img) {
+		perror("malloc");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++)
+		check_fixture(&fixtures[i], img);
+
+	check_blank(img);
+	check_cache(img);
+
+	free(img);
+
+	if (failures) {
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
+
+static int split_image(const char *file, uint32_t erasesize,
+		       enum mtd_parser_type type)
+{
+	struct mtd_info mtd = {
+		.name = file,
+		.erasesize = erasesize,
+	};
+	const struct mtd_partition *parts;
+	const char *name = NULL;
+	u_char *img;
+	long len;
+	FILE *f;
+	int ret, i;
+
+	f = fopen(file, "r");
+	if (!f || fseek(f, 0, SEEK_END) || (len = ftell(f)) <= 0) {
+		perror(file);
+		return 1;
+	}
+	rewind(f);
+
+	/* pad the image to a whole number of erase blocks, like the flash */
+	mtd.size = (len + erasesize - 1) / erasesize * erasesize;
+	img = malloc(mtd.size);
+	if (!img) {
+		perror("malloc");
+		return 1;
+	}
+
+	memset(img, 0xff, mtd.size);
+	if (fread(img, 1, len, f) != len) {
+		perror(file);
+		return 1;
+	}
+	fclose(f);
+
+	mtd.data = img;
+	ret = run_parsers(&mtd, type, &parts, &name);
+	if (ret <= 0) {
+		printf("no partitions found (%d), %u flash reads\n", ret,
+		       mtd.reads);
+		free(img);
+		return 1;
+	}
+
+	printf("%d %s partitions found, %u flash reads\n", ret, name,
+	       mtd.reads);
+	for (i = 0; i < ret; i++)
+		printf("0x%08llx-0x%08llx : \"%s\"\n",
+		       (unsigned long long) parts[i].offset,
+		       (unsigned long long) (parts[i].offset + parts[i].size),
+		       parts[i].name);
+
+	kfree(parts);
+	free(img);
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-v] [-r] [-e <erasesize>] [<image>]\n"
+		"\n"
+		"Without an image, check the parsers against built-in fixtures.\n"
+		"\n"
+		"  -v              print parser debug messages\n"
+		"  -r              run the rootfs parsers instead of the firmware ones\n"
+		"  -e <erasesize>  erase block size (default 0x%x)\n",
+		prog, ERASESIZE);
+}
+
+int main(int argc, char **argv)
+{
+	enum mtd_parser_type type = MTD_PARSER_TYPE_FIRMWARE;
+	uint32_t erasesize = ERASESIZE;
+	int c;
+
+	while ((c = getopt(argc, argv, "ve:rh")) != -1) {
+		switch (c) {
+		case 'v':
+			mtdsplit_test_verbose = 1;
+			break;
+		case 'e':
+			erasesize = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			type = MTD_PARSER_TYPE_ROOTFS;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!erasesize) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (optind < argc)
+		return split_image(argv[optind], erasesize, type);
+
+	return self_test();
+}
@@ -41,28 +41,82 @@ static bool pad_to_stdout = false;
 			progname, ## __VA_ARGS__, strerror(save)); \
 } while (0)
 
-#define BUF_SIZE	(64 * 1024)
+#define BUF_SIZE	(1024 * 1024)
 #define ALIGN(_x,_y)	(((_x) + ((_y) - 1)) & ~((_y) - 1))
 
-static int pad_image(char *name, uint32_t pad_mask)
+struct out_buf {
+	int fd;
+	char *name;
+	unsigned char *buf;
+	size_t used;
+};
+
+static int out_flush(struct out_buf *out)
+{
+	unsigned char *p = out->buf;
+	ssize_t t;
+
+	while (out->used) {
+		t = write(out->fd, p, out->used);
+		if (t <= 0) {
+			ERRS("Unable to write to %s", out->name);
+			return -1;
+		}
+
+		p += t;
+		out->used -= t;
+	}
+
+	return 0;
+}
+
+static int out_put(struct out_buf *out, const unsigned char *data,
+		   size_t len)
+{
+	size_t chunk;
+
+	while (len) {
+		chunk = BUF_SIZE - out->used;
+		if (chunk > len)
+			chunk = len;
+
+		if (data) {
+			memcpy(out->buf + out->used, data, chunk);
+			data += chunk;
+		} else {
+			memset(out->buf + out->used, '\xff', chunk);
+		}
+
+		out->used += chunk;
+		len -= chunk;
+
+		if (out->used == BUF_SIZE && out_flush(out))
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * All alignment steps are computed up front, the 0xff filler and the
+ * end-of-filesystem markers between them are then appended in a single
+ * pass of large writes.
+ */
+static int pad_image(char *name, uint32_t pad_mask, unsigned char *buf)
 {
-	char *buf;
+	struct out_buf out = {
+		.name = name,
+		.buf = buf,
+	};
 	int fd;
-	int outfd;
 	ssize_t in_len;
 	ssize_t out_len;
 	int ret = -1;
 
-	buf = malloc(BUF_SIZE);
-	if (!buf) {
-		ERR("No memory for buffer");
-		goto out;
-	}
-
 	fd = open(name, O_RDWR);
 	if (fd < 0) {
 		ERRS("Unable to open %s", name);
-		goto free_buf;
+		goto out;
 	}
 
 	in_len = lseek(fd, 0, SEEK_END);
@@ -70,18 +124,15 @@ static int pad_image(char *name, uint32_t pad_mask)
 		goto close;
 
 	if (!pad_to_stdout)
-		outfd = fd;
+		out.fd = fd;
 	else
-		outfd = STDOUT_FILENO;
-
-	memset(buf, '\xff', BUF_SIZE);
+		out.fd = STDOUT_FILENO;
 
 	in_len += xtra_offset;
 
 	out_len = in_len;
 	while (pad_mask) {
 		uint32_t mask;
-		ssize_t t;
 		int i;
 
 		for (i = 10; i < 32; i++) {
@@ -100,37 +151,23 @@ static int pad_image(char *name, uint32_t pad_mask)
 
 		fprintf(stderr, "padding image to %08x\n", (unsigned int) in_len - xtra_offset);
 
-		while (out_len < in_len) {
-			ssize_t len;
-
-			len = in_len - out_len;
-			if (len > BUF_SIZE)
-				len = BUF_SIZE;
-
-			t = write(outfd, buf, len);
-			if (t != len) {
-				ERRS("Unable to write to %s", name);
-				goto close;
-			}
-
-			out_len += len;
-		}
+		if (out_put(&out, NULL, in_len - out_len))
+			goto close;
 
 		/* write out the JFFS end-of-filesystem marker */
-		t = write(outfd, pad, pad_len);
-		if (t != pad_len) {
-			ERRS("Unable to write to %s", name);
+		if (out_put(&out, pad, pad_len))
 			goto close;
-		}
-		out_len += pad_len;
+
+		out_len = in_len + pad_len;
 	}
 
+	if (out_flush(&out))
+		goto close;
+
 	ret = 0;
 
 close:
 	close(fd);
-free_buf:
-	free(buf);
 out:
 	return ret;
 }
@@ -138,7 +175,7 @@ out:
 static int usage(void)
 {
 	fprintf(stderr,
-		"Usage: %s file [<options>] [pad0] [pad1] [padN]\n"
+		"Usage: %s file [file...] [<options>] [pad0] [pad1] [padN]\n"
 		"Options:\n"
 		"  -x <offset>:          Add an extra offset for padding data\n"
 		"  -J:                   Use a fake big-endian jffs2 padding element instead of EOF\n"
@@ -151,9 +188,19 @@ static int usage(void)
 	return EXIT_FAILURE;
 }
 
+static bool is_number(const char *arg)
+{
+	char *end;
+
+	strtoul(arg, &end, 0);
+	return *arg && !*end;
+}
+
 int main(int argc, char* argv[])
 {
-	char *image;
+	char **images;
+	int n_images = 0;
+	unsigned char *buf;
 	uint32_t pad_mask;
 	int ret = EXIT_FAILURE;
 	int err;
@@ -164,9 +211,14 @@ int main(int argc, char* argv[])
 	if (argc < 2)
 		return usage();
 
-	image = argv[1];
-	argv++;
-	argc--;
+	/* leading arguments up to the first option or pad size are images */
+	images = &argv[1];
+	while (n_images + 1 < argc && argv[n_images + 1][0] != '-' &&
+	       (!n_images || !is_number(argv[n_images + 1])))
+		n_images++;
+
+	argv += n_images;
+	argc -= n_images;
 
 	pad_mask = 0;
 	while ((ch = getopt(argc, argv, "x:Jjc")) != -1) {
@@ -199,12 +251,22 @@ int main(int argc, char* argv[])
 		pad_mask = (4 * 1024) | (8 * 1024) | (64 * 1024) |
 			   (128 * 1024);
 
-	err = pad_image(image, pad_mask);
-	if (err)
+	buf = malloc(BUF_SIZE);
+	if (!buf) {
+		ERR("No memory for buffer");
 		goto out;
+	}
+
+	for (i = 0; i < n_images; i++) {
+		err = pad_image(images[i], pad_mask, buf);
+		if (err)
+			goto free_buf;
+	}
 
 	ret = EXIT_SUCCESS;
 
+free_buf:
+	free(buf);
 out:
 	return ret;
 }